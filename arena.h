@@ -0,0 +1,98 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for AST nodes.
+//
+// The parser allocates every node from one of these instead of doing a
+// separate heap allocation (plus shared_ptr control block) per node. Nodes
+// are referenced by raw, non-owning pointers inside the tree, and the whole
+// tree is released in one shot when the arena is destroyed or reset.
+class AstArena {
+public:
+    AstArena() = default;
+    ~AstArena() { reset(); }
+
+    // Non-copyable: the arena owns raw memory referenced by live nodes.
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    // Construct a T inside the arena. Non-trivially-destructible types are
+    // registered so reset() can run their destructors (nodes own std::string
+    // and std::vector members whose storage lives outside the arena).
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        void* mem = allocate(sizeof(T), alignof(T));
+        T* obj = new (mem) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            destructors.push_back({obj, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return obj;
+    }
+
+    // Raw allocation from the current block, growing as needed.
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (used + align - 1) & ~(align - 1);
+        if (current == nullptr || offset + size > capacity) {
+            newBlock(size);
+            offset = 0;
+        }
+        void* result = current + offset;
+        used = offset + size;
+        return result;
+    }
+
+    // Destroy all registered objects and release every block.
+    void reset() {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+            it->destroy(it->object);
+        }
+        destructors.clear();
+        for (char* block : blocks) {
+            std::free(block);
+        }
+        blocks.clear();
+        current = nullptr;
+        used = 0;
+        capacity = 0;
+    }
+
+    // Total bytes currently reserved by the arena.
+    size_t bytesReserved() const {
+        size_t total = 0;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            total += (i + 1 == blocks.size()) ? capacity : BLOCK_SIZE;
+        }
+        return total;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    void newBlock(size_t minSize) {
+        capacity = minSize > BLOCK_SIZE ? minSize : BLOCK_SIZE;
+        current = static_cast<char*>(std::malloc(capacity));
+        if (!current) throw std::bad_alloc();
+        blocks.push_back(current);
+        used = 0;
+    }
+
+    std::vector<char*> blocks;
+    std::vector<Destructor> destructors;
+    char* current = nullptr;
+    size_t used = 0;
+    size_t capacity = 0;
+};
+
+#endif // ARENA_H
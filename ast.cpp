@@ -1,4 +1,5 @@
 #include "ast.h"
+#include "strkernels.h"
 #include <algorithm>
 #include <sstream>
 #include <set>
@@ -22,7 +23,7 @@ void ObjectNode::print(std::ostream& os, int indent) const {
     
     for (const auto& pair : pairs) {
         printIndent(os, indent + 1);
-        os << "\"" << pair.key << "\": ";
+        os << "\"" << pair.key->text << "\": ";
         pair.value->print(os, indent + 1);
         os << "\n";
     }
@@ -52,8 +53,16 @@ void ArrayNode::print(std::ostream& os, int indent) const {
 }
 
 // Print string node
+const std::string& StringNode::str() const {
+    if (!decoded) {
+        value = strkernels::unescapeJson(rawData, rawLength);
+        decoded = true;
+    }
+    return value;
+}
+
 void StringNode::print(std::ostream& os, int indent) const {
-    os << "STRING \"" << value << "\"";
+    os << "STRING \"" << str() << "\"";
 }
 
 // Print number node
@@ -81,22 +90,32 @@ void AST::print(std::ostream& os) const {
     }
 }
 
-// Get a signature of object keys for table identification
-std::string ObjectNode::getKeySignature() const {
-    std::vector<std::string> keys;
-    for (const auto& pair : pairs) {
-        keys.push_back(pair.key);
-    }
-    
-    std::sort(keys.begin(), keys.end());
-    
-    std::stringstream ss;
-    for (size_t i = 0; i < keys.size(); ++i) {
-        if (i > 0) ss << ",";
-        ss << keys[i];
+// Whether two objects carry the same key set. Keys are interned, so equal
+// text means equal pointers: the common case - same keys in the same
+// order - is a straight pointer-sequence compare, and only objects that
+// list the same keys in a different order pay for the sorted comparison.
+// This replaces joining every object's sorted keys into a signature
+// string per element.
+static bool sameKeyShape(const ObjectNode* a, const ObjectNode* b) {
+    if (a->pairs.size() != b->pairs.size()) return false;
+
+    bool sameOrder = true;
+    for (size_t i = 0; i < a->pairs.size(); ++i) {
+        if (a->pairs[i].key != b->pairs[i].key) {
+            sameOrder = false;
+            break;
+        }
     }
-    
-    return ss.str();
+    if (sameOrder) return true;
+
+    std::vector<const InternedString*> keysA, keysB;
+    keysA.reserve(a->pairs.size());
+    keysB.reserve(b->pairs.size());
+    for (const auto& pair : a->pairs) keysA.push_back(pair.key);
+    for (const auto& pair : b->pairs) keysB.push_back(pair.key);
+    std::sort(keysA.begin(), keysA.end());
+    std::sort(keysB.begin(), keysB.end());
+    return keysA == keysB;
 }
 
 // Check if this is an array of objects with the same structure
@@ -112,12 +131,9 @@ bool ArrayNode::isArrayOfObjects() const {
     
     // Check if all objects have the same structure
     if (elements.size() > 1) {
-        auto firstObject = std::dynamic_pointer_cast<ObjectNode>(elements[0]);
-        std::string signature = firstObject->getKeySignature();
-        
+        auto firstObject = elements[0]->asObject();
         for (size_t i = 1; i < elements.size(); ++i) {
-            auto obj = std::dynamic_pointer_cast<ObjectNode>(elements[i]);
-            if (obj->getKeySignature() != signature) {
+            if (!sameKeyShape(elements[i]->asObject(), firstObject)) {
                 return false;
             }
         }
@@ -141,99 +157,3 @@ bool ArrayNode::isArrayOfScalars() const {
     
     return true;
 }
-
-// Get the signature of objects if this is an array of objects
-std::string ArrayNode::getObjectSignature() const {
-    if (!isArrayOfObjects() || elements.empty()) {
-        return "";
-    }
-    
-    auto firstObject = std::dynamic_pointer_cast<ObjectNode>(elements[0]);
-    return firstObject->getKeySignature();
-}
-
-// Assign IDs to all nodes in the AST
-void AST::assignIds() {
-    if (!root) return;
-    
-    std::map<std::string, int> tableIds;
-    root->assignIds(1, tableIds);
-}
-
-// Assign IDs to object nodes
-int ObjectNode::assignIds(int nextId, std::map<std::string, int>& tableIds) {
-    // Determine table name from parent key or use default
-    if (parentTable.empty()) {
-        tableName = "root"; // Root object
-    } else if (!parentKey.empty()) {
-        tableName = parentKey; // Use the key from parent
-    } else {
-        std::stringstream ss;
-        ss << parentTable << "_" << nextId; // Fallback name
-        tableName = ss.str();
-    }
-    
-    // Assign ID
-    id = nextId++;
-    
-    // Process all key-value pairs
-    for (auto& pair : pairs) {
-        if (pair.value->getType() == NodeType::OBJECT) {
-            // Handle nested object
-            auto objectNode = std::dynamic_pointer_cast<ObjectNode>(pair.value);
-            objectNode->parentId = id;
-            objectNode->parentTable = tableName;
-            objectNode->parentKey = pair.key;
-            nextId = objectNode->assignIds(nextId, tableIds);
-        } 
-        else if (pair.value->getType() == NodeType::ARRAY) {
-            // Handle array
-            auto arrayNode = std::dynamic_pointer_cast<ArrayNode>(pair.value);
-            arrayNode->parentId = id;
-            arrayNode->parentTable = tableName;
-            arrayNode->parentKey = pair.key;
-            nextId = arrayNode->assignIds(nextId, tableIds);
-        }
-    }
-    
-    return nextId;
-}
-
-// Assign IDs to array nodes
-int ArrayNode::assignIds(int nextId, std::map<std::string, int>& tableIds) {
-    // If array contains objects, we need to process them
-    if (isArrayOfObjects()) {
-        // Process each object element
-        int index = 0;
-        for (auto& element : elements) {
-            if (element->getType() == NodeType::OBJECT) {
-                auto objectNode = std::dynamic_pointer_cast<ObjectNode>(element);
-                objectNode->parentId = parentId;
-                objectNode->parentTable = parentTable;
-                
-                // If no parent key is set, use a numeric index
-                if (parentKey.empty()) {
-                    std::stringstream ss;
-                    ss << "item_" << index;
-                    objectNode->parentKey = ss.str();
-                } else {
-                    objectNode->parentKey = parentKey + "_" + std::to_string(index);
-                }
-                
-                nextId = objectNode->assignIds(nextId, tableIds);
-            }
-            index++;
-        }
-    }
-    
-    // For scalar arrays, we don't need to assign IDs to the elements
-    // They will be handled by the CSV generator
-    
-    return nextId;
-}
-
-// These nodes don't need to assign IDs
-int StringNode::assignIds(int nextId, std::map<std::string, int>&) { return nextId; }
-int NumberNode::assignIds(int nextId, std::map<std::string, int>&) { return nextId; }
-int BooleanNode::assignIds(int nextId, std::map<std::string, int>&) { return nextId; }
-int NullNode::assignIds(int nextId, std::map<std::string, int>&) { return nextId; }
\ No newline at end of file
@@ -4,8 +4,9 @@
 #include <string>
 #include <vector>
 #include <map>
-#include <memory>
 #include <iostream>
+#include "arena.h"
+#include "intern.h"
 
 // Forward declarations
 class AstNode;
@@ -28,84 +29,111 @@ enum class NodeType {
 };
 
 // Base class for all AST nodes
+// Carries its concrete type as a tag so the tree walks dispatch on the enum
+// and downcast with plain static_casts instead of RTTI lookups.
 class AstNode {
 public:
+    explicit AstNode(NodeType t) : type(t) {}
     virtual ~AstNode() = default;
-    virtual NodeType getType() const = 0;
+
+    NodeType getType() const { return type; }
+
     virtual void print(std::ostream& os, int indent = 0) const = 0;
-    
-    // For table generation
-    virtual int assignIds(int nextId, std::map<std::string, int>& tableIds) = 0;
+
+    // Checked downcasts: return nullptr when the tag doesn't match,
+    // mirroring dynamic_cast semantics without the RTTI cost.
+    // (Defined after the concrete classes below.)
+    ObjectNode* asObject();
+    ArrayNode* asArray();
+    StringNode* asString();
+    NumberNode* asNumber();
+    BooleanNode* asBoolean();
+    NullNode* asNull();
+
+private:
+    NodeType type;
 };
 
 // Class for key-value pair in an object
+// The value pointer is non-owning; node storage belongs to the AST's arena.
+// Keys are interned: identical keys across objects share one InternedString.
 class KeyValuePair {
 public:
-    std::string key;
-    std::shared_ptr<AstNode> value;
-    
-    KeyValuePair(const std::string& k, std::shared_ptr<AstNode> v) 
-        : key(k), value(std::move(v)) {}
+    const InternedString* key;
+    AstNode* value;
+
+    KeyValuePair(const InternedString* k, AstNode* v)
+        : key(k), value(v) {}
 };
 
 // Class for JSON object node
 class ObjectNode : public AstNode {
 public:
+    ObjectNode() : AstNode(NodeType::OBJECT) {}
+
     std::vector<KeyValuePair> pairs;
     std::string tableName;  // Derived table name
+    int tableId = -1;      // Dense table id (see CSVGenerator::registerTable)
     int id = -1;           // Assigned row id
     int parentId = -1;     // Parent object's id (for foreign key)
     std::string parentTable; // Parent table name
     std::string parentKey;   // The key in parent object that points to this object
     int arrayIndex = -1;    // Array index if this is an array element
     
-    NodeType getType() const override { return NodeType::OBJECT; }
     void print(std::ostream& os, int indent = 0) const override;
-    int assignIds(int nextId, std::map<std::string, int>& tableIds) override;
-    
-    // Helper to get a signature of keys (for table identification)
-    std::string getKeySignature() const;
 };
 
 // Class for JSON array node
 class ArrayNode : public AstNode {
 public:
-    std::vector<std::shared_ptr<AstNode>> elements;
+    ArrayNode() : AstNode(NodeType::ARRAY) {}
+
+    std::vector<AstNode*> elements;  // Non-owning; storage lives in the arena
     std::string parentKey;  // Key in parent object (if any)
     int parentId = -1;     // Parent object's id
     std::string parentTable; // Parent table name
     
-    NodeType getType() const override { return NodeType::ARRAY; }
     void print(std::ostream& os, int indent = 0) const override;
-    int assignIds(int nextId, std::map<std::string, int>& tableIds) override;
     
     // Check if this is an array of objects with the same structure
     bool isArrayOfObjects() const;
     
     // Check if this is an array of scalar values
     bool isArrayOfScalars() const;
-    
-    // Get the signature of objects if this is an array of objects
-    std::string getObjectSignature() const;
 };
 
 // Base class for all value nodes
 class ValueNode : public AstNode {
 public:
+    explicit ValueNode(NodeType t) : AstNode(t) {}
     virtual std::string toString() const = 0;
 };
 
 // Class for string value
+// Holds either an eagerly decoded value or a raw undecoded slice of the
+// input buffer (--fast-scan); the slice is only unescaped on first access,
+// so values that never reach the output are never decoded.
 class StringNode : public ValueNode {
 public:
-    std::string value;
-    
-    explicit StringNode(std::string v) : value(std::move(v)) {}
-    
-    NodeType getType() const override { return NodeType::STRING; }
+    explicit StringNode(std::string v)
+        : ValueNode(NodeType::STRING), value(std::move(v)), decoded(true) {}
+
+    // Lazy form over a buffer that outlives the node (the mmap/slurp of
+    // the input stays alive through generation)
+    StringNode(const char* raw, size_t rawLen)
+        : ValueNode(NodeType::STRING), rawData(raw), rawLength(rawLen) {}
+
+    // Decoded value, unescaping the raw slice on first call
+    const std::string& str() const;
+
     void print(std::ostream& os, int indent = 0) const override;
-    int assignIds(int nextId, std::map<std::string, int>& tableIds) override;
-    std::string toString() const override { return value; }
+    std::string toString() const override { return str(); }
+
+private:
+    mutable std::string value;
+    const char* rawData = nullptr;
+    size_t rawLength = 0;
+    mutable bool decoded = false;
 };
 
 // Class for number value
@@ -113,11 +141,10 @@ class NumberNode : public ValueNode {
 public:
     std::string value;  // Keep as string to preserve precision
     
-    explicit NumberNode(std::string v) : value(std::move(v)) {}
+    explicit NumberNode(std::string v)
+        : ValueNode(NodeType::NUMBER), value(std::move(v)) {}
     
-    NodeType getType() const override { return NodeType::NUMBER; }
     void print(std::ostream& os, int indent = 0) const override;
-    int assignIds(int nextId, std::map<std::string, int>& tableIds) override;
     std::string toString() const override { return value; }
 };
 
@@ -126,43 +153,67 @@ class BooleanNode : public ValueNode {
 public:
     bool value;
     
-    explicit BooleanNode(bool v) : value(v) {}
+    explicit BooleanNode(bool v)
+        : ValueNode(NodeType::BOOLEAN), value(v) {}
     
-    NodeType getType() const override { return NodeType::BOOLEAN; }
     void print(std::ostream& os, int indent = 0) const override;
-    int assignIds(int nextId, std::map<std::string, int>& tableIds) override;
     std::string toString() const override { return value ? "true" : "false"; }
 };
 
 // Class for null value
 class NullNode : public ValueNode {
 public:
-    NodeType getType() const override { return NodeType::NULL_VALUE; }
+    NullNode() : ValueNode(NodeType::NULL_VALUE) {}
+
     void print(std::ostream& os, int indent = 0) const override;
-    int assignIds(int nextId, std::map<std::string, int>& tableIds) override;
     std::string toString() const override { return ""; }
 };
 
-// Main AST class 
+// Tagged downcast helpers (need the concrete class definitions above)
+inline ObjectNode* AstNode::asObject() {
+    return type == NodeType::OBJECT ? static_cast<ObjectNode*>(this) : nullptr;
+}
+inline ArrayNode* AstNode::asArray() {
+    return type == NodeType::ARRAY ? static_cast<ArrayNode*>(this) : nullptr;
+}
+inline StringNode* AstNode::asString() {
+    return type == NodeType::STRING ? static_cast<StringNode*>(this) : nullptr;
+}
+inline NumberNode* AstNode::asNumber() {
+    return type == NodeType::NUMBER ? static_cast<NumberNode*>(this) : nullptr;
+}
+inline BooleanNode* AstNode::asBoolean() {
+    return type == NodeType::BOOLEAN ? static_cast<BooleanNode*>(this) : nullptr;
+}
+inline NullNode* AstNode::asNull() {
+    return type == NodeType::NULL_VALUE ? static_cast<NullNode*>(this) : nullptr;
+}
+
+// Main AST class
+// Owns the arena that all node storage is allocated from; the entire tree is
+// freed in one shot when the AST is destroyed.
 class AST {
 private:
-    std::shared_ptr<AstNode> root;
-    
+    AstArena nodeArena;
+    AstNode* root = nullptr;
+
 public:
     AST() = default;
-    
-    void setRoot(std::shared_ptr<AstNode> node) {
-        root = std::move(node);
+
+    void setRoot(AstNode* node) {
+        root = node;
     }
-    
-    std::shared_ptr<AstNode> getRoot() const {
+
+    AstNode* getRoot() const {
         return root;
     }
-    
+
+    // Arena the parser allocates nodes from
+    AstArena& arena() {
+        return nodeArena;
+    }
+
     void print(std::ostream& os) const;
-    
-    // Assign IDs to all nodes in the AST
-    void assignIds();
 };
 
 #endif // AST_H
\ No newline at end of file
@@ -0,0 +1,194 @@
+// Benchmark harness for json2relcsv (built by `make bench`).
+//
+// Generates parameterized synthetic JSON inputs — wide objects, deep
+// nesting, long scalar arrays, large root arrays — and runs the pipeline
+// phases (parse, generateCSV) separately, reporting wall-clock
+// time and peak RSS per phase as a regression-comparable table.
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <sys/resource.h>
+#include "ast.h"
+#include "csv_generator.h"
+
+// External declarations from parser
+extern AST ast;
+extern int yyparse();
+extern FILE *yyin;
+extern bool has_syntax_error;
+
+// Referenced by the parser; the harness never prints the AST
+bool print_ast = false;
+
+namespace {
+
+// Peak resident set size in kilobytes
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void reportPhase(const std::string& scenario, const std::string& phase,
+                 double wallMs) {
+    std::cout << std::left << std::setw(16) << scenario
+              << std::setw(12) << phase
+              << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << wallMs
+              << std::setw(14) << peakRssKb() << std::endl;
+}
+
+// --- Synthetic input generators ---
+
+// Root array of `records` objects with `width` scalar fields each
+void generateWideObjects(std::ofstream& out, int records, int width) {
+    out << "[";
+    for (int r = 0; r < records; ++r) {
+        if (r > 0) out << ",";
+        out << "{";
+        for (int c = 0; c < width; ++c) {
+            if (c > 0) out << ",";
+            out << "\"field" << c << "\":";
+            if (c % 3 == 0) {
+                out << r * width + c;
+            } else {
+                out << "\"value_" << r << "_" << c << "\"";
+            }
+        }
+        out << "}";
+    }
+    out << "]";
+}
+
+// One object nested `depth` levels deep
+void generateDeepNesting(std::ofstream& out, int depth) {
+    for (int d = 0; d < depth; ++d) {
+        out << "{\"level" << d << "\":" << d << ",\"child\":";
+    }
+    out << "{\"leaf\":true}";
+    for (int d = 0; d < depth; ++d) {
+        out << "}";
+    }
+}
+
+// Root array of objects each carrying a scalar array of `arrayLen` entries
+void generateScalarArrays(std::ofstream& out, int records, int arrayLen) {
+    out << "[";
+    for (int r = 0; r < records; ++r) {
+        if (r > 0) out << ",";
+        out << "{\"name\":\"rec" << r << "\",\"values\":[";
+        for (int i = 0; i < arrayLen; ++i) {
+            if (i > 0) out << ",";
+            out << (r + i);
+        }
+        out << "]}";
+    }
+    out << "]";
+}
+
+// Run one scenario file through the phased pipeline
+void runScenario(const std::string& name, const std::string& inputFile,
+                 const std::string& outDir) {
+    yyin = fopen(inputFile.c_str(), "r");
+    if (!yyin) {
+        std::cerr << "bench: cannot open " << inputFile << std::endl;
+        return;
+    }
+
+    has_syntax_error = false;
+    auto start = std::chrono::steady_clock::now();
+    int result = yyparse();
+    reportPhase(name, "parse", elapsedMs(start));
+    fclose(yyin);
+
+    if (result != 0 || has_syntax_error) {
+        std::cerr << "bench: parse failed for " << name << std::endl;
+        return;
+    }
+
+    start = std::chrono::steady_clock::now();
+    CSVGenerator generator(outDir);
+    generator.generateCSV(ast);
+    reportPhase(name, "generate", elapsedMs(start));
+
+    // Release this scenario's tree before the next one
+    ast.setRoot(nullptr);
+    ast.arena().reset();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int records = 10000;
+    int width = 40;
+    int depth = 200;
+    int arrayLen = 100;
+    std::string workDir = "/tmp";
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) {
+            records = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            width = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--array-len") == 0 && i + 1 < argc) {
+            arrayLen = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--work-dir") == 0 && i + 1 < argc) {
+            workDir = argv[++i];
+        } else {
+            std::cerr << "Usage: json2relbench [--records N] [--width N] [--depth N]"
+                      << " [--array-len N] [--work-dir DIR]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(16) << "scenario"
+              << std::setw(12) << "phase"
+              << std::right << std::setw(12) << "wall_ms"
+              << std::setw(14) << "peak_rss_kb" << std::endl;
+
+    struct Scenario {
+        std::string name;
+        void (*generate)(std::ofstream&, int, int);
+        int a, b;
+    };
+    std::vector<Scenario> scenarios = {
+        {"wide-objects", generateWideObjects, records, width},
+        {"deep-nesting", [](std::ofstream& out, int d, int) { generateDeepNesting(out, d); }, depth, 0},
+        {"scalar-arrays", generateScalarArrays, records / 10, arrayLen},
+    };
+
+    for (const auto& scenario : scenarios) {
+        std::string inputFile = workDir + "/bench_" + scenario.name + ".json";
+        std::string outDir = workDir + "/bench_" + scenario.name + "_out";
+
+        std::ofstream input(inputFile);
+        if (!input.is_open()) {
+            std::cerr << "bench: cannot write " << inputFile << std::endl;
+            return 1;
+        }
+        scenario.generate(input, scenario.a, scenario.b);
+        input.close();
+
+        std::string mkdir = "mkdir -p " + outDir;
+        if (std::system(mkdir.c_str()) != 0) {
+            std::cerr << "bench: cannot create " << outDir << std::endl;
+            return 1;
+        }
+
+        runScenario(scenario.name, inputFile, outDir);
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "columnar_writer.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// All multi-byte fields are little-endian; appending the host bytes is
+// correct on every target the SSE2/SWAR kernels already assume
+void appendU32(std::string& out, uint32_t v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void appendU64(std::string& out, uint64_t v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+} // namespace
+
+namespace columnar {
+
+void writeTable(BufferedCSVWriter& out, const std::vector<std::string>& columns,
+                const RowBuffer& rows) {
+    const size_t rowCount = rows.size();
+
+    std::string header;
+    header += "J2RC";
+    appendU32(header, 1);
+    out.writeRaw(header.data(), header.size());
+    uint64_t position = header.size();
+
+    // One chunk per column, remembering where each one landed
+    std::vector<uint64_t> chunkOffsets(columns.size());
+    std::vector<uint64_t> chunkLengths(columns.size());
+    std::string chunk;
+    for (size_t c = 0; c < columns.size(); ++c) {
+        chunk.clear();
+        switch (rows.columnKind(c)) {
+            case CellKind::EMPTY:
+                // Never received a value; the footer entry says it all
+                break;
+            case CellKind::TEXT: {
+                const std::vector<size_t>& offsets = rows.textOffsets(c);
+                const std::string& bytes = rows.textBytes(c);
+                for (size_t r = 0; r < rowCount; ++r) {
+                    appendU64(chunk, offsets[r]);
+                }
+                appendU64(chunk, bytes.size());
+                chunk += bytes;
+                break;
+            }
+            case CellKind::INT64: {
+                const std::vector<unsigned char>& present = rows.presence(c);
+                const std::vector<long long>& values = rows.nativeValues(c);
+                chunk.append(reinterpret_cast<const char*>(present.data()), rowCount);
+                for (size_t r = 0; r < rowCount; ++r) {
+                    appendU64(chunk, static_cast<uint64_t>(values[r]));
+                }
+                break;
+            }
+            case CellKind::BOOL: {
+                const std::vector<unsigned char>& present = rows.presence(c);
+                const std::vector<long long>& values = rows.nativeValues(c);
+                chunk.append(reinterpret_cast<const char*>(present.data()), rowCount);
+                for (size_t r = 0; r < rowCount; ++r) {
+                    chunk += static_cast<char>(values[r] ? 1 : 0);
+                }
+                break;
+            }
+        }
+        chunkOffsets[c] = position;
+        chunkLengths[c] = chunk.size();
+        if (!chunk.empty()) {
+            out.writeRaw(chunk.data(), chunk.size());
+            position += chunk.size();
+        }
+    }
+
+    // Footer index plus the trailer that locates it
+    std::string footer;
+    appendU32(footer, static_cast<uint32_t>(columns.size()));
+    appendU64(footer, rowCount);
+    for (size_t c = 0; c < columns.size(); ++c) {
+        footer += static_cast<char>(rows.columnKind(c));
+        appendU32(footer, static_cast<uint32_t>(columns[c].size()));
+        footer += columns[c];
+        appendU64(footer, chunkOffsets[c]);
+        appendU64(footer, chunkLengths[c]);
+    }
+    appendU64(footer, position);
+    footer += "J2RC";
+    out.writeRaw(footer.data(), footer.size());
+}
+
+} // namespace columnar
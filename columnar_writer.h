@@ -0,0 +1,44 @@
+#ifndef COLUMNAR_WRITER_H
+#define COLUMNAR_WRITER_H
+
+#include <string>
+#include <vector>
+
+#include "csv_generator.h"
+
+// Columnar binary output backend (--format columnar).
+//
+// Downstream loaders that re-parse our CSVs back into typed columns pay
+// for the text round-trip twice; this backend writes each table as a
+// footer-indexed chunked binary file (<table>.colbin) instead, straight
+// out of the RowBuffer's committed column representations — the physical
+// type of every column is whatever CellKind its storage committed to, so
+// int64 and bool columns ship as native arrays with no formatting at all.
+//
+// File layout (all integers little-endian):
+//
+//   "J2RC" u32 version(1)
+//   one chunk per column, back to back:
+//     TEXT   u64 offsets[rows+1], then the cell bytes
+//     INT64  u8 present[rows], then i64 values[rows]
+//     BOOL   u8 present[rows], then u8 values[rows]
+//     EMPTY  nothing (zero-length chunk)
+//   footer:
+//     u32 columnCount, u64 rowCount
+//     per column: u8 kind, u32 nameLen, name bytes, u64 offset, u64 length
+//   u64 footerOffset, "J2RC"
+//
+// Readers seek to the trailer, find the footer, and fetch only the column
+// chunks they need.
+
+namespace columnar {
+
+// Serialize one table into `out`. Goes through BufferedCSVWriter so the
+// binary chunks get the same large buffered writes, async double
+// buffering, and --compress handling as the CSV backend.
+void writeTable(BufferedCSVWriter& out, const std::vector<std::string>& columns,
+                const RowBuffer& rows);
+
+} // namespace columnar
+
+#endif // COLUMNAR_WRITER_H
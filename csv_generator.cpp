@@ -1,6 +1,14 @@
 #include "csv_generator.h"
+#include "columnar_writer.h"
+#include "fastfmt.h"
+#include "strkernels.h"
+#include "stats.h"
 #include <iostream>
+#include <chrono>
+#include <atomic>
 #include <sstream>
+#include <thread>
+#include <cstdlib>
 #include <algorithm>
 #include <filesystem>
 #include <set>
@@ -40,6 +48,275 @@ std::string getSingularForm(const std::string& plural) {
     return singular;
 }
 
+void RowScratch::renderCell(size_t i, std::string& out) const {
+    switch (kinds[i]) {
+        case CellKind::EMPTY:
+            break;
+        case CellKind::TEXT:
+            out += texts[i];
+            break;
+        case CellKind::INT64:
+            fastfmt::appendInt(out, ints[i]);
+            break;
+        case CellKind::BOOL:
+            out += ints[i] ? "true" : "false";
+            break;
+    }
+}
+
+void RowBuffer::setWidth(size_t columnCount) {
+    columns.assign(columnCount, Column{});
+    rowCount = 0;
+}
+
+void RowBuffer::reserveRows(size_t rowEstimate, size_t avgCellBytes) {
+    // Columns commit their storage kind lazily, so just remember the hint
+    // and let commit() apply it to whichever representation wins
+    reserveHint = rowEstimate;
+    reserveCellBytes = avgCellBytes;
+    for (auto& col : columns) {
+        if (col.kind == CellKind::TEXT) {
+            col.offsets.reserve(col.offsets.size() + rowEstimate);
+            col.bytes.reserve(col.bytes.size() + rowEstimate * avgCellBytes);
+        } else if (col.kind == CellKind::INT64 || col.kind == CellKind::BOOL) {
+            col.values.reserve(col.values.size() + rowEstimate);
+            col.present.reserve(col.present.size() + rowEstimate);
+        }
+    }
+}
+
+void RowBuffer::Column::commit(CellKind k, size_t priorRows, size_t hint) {
+    kind = k;
+    if (k == CellKind::TEXT) {
+        offsets.reserve(priorRows + hint);
+        offsets.assign(priorRows, 0);
+    } else {
+        values.reserve(priorRows + hint);
+        present.reserve(priorRows + hint);
+        values.assign(priorRows, 0);
+        present.assign(priorRows, 0);
+    }
+}
+
+void RowBuffer::Column::promoteToText() {
+    CellKind from = kind;
+    kind = CellKind::TEXT;
+    bytes.clear();
+    offsets.clear();
+    offsets.reserve(values.size());
+    for (size_t r = 0; r < values.size(); ++r) {
+        offsets.push_back(bytes.size());
+        if (!present[r]) continue;
+        if (from == CellKind::INT64) {
+            fastfmt::appendInt(bytes, values[r]);
+        } else {
+            bytes += values[r] ? "true" : "false";
+        }
+    }
+    values.clear();
+    values.shrink_to_fit();
+    present.clear();
+    present.shrink_to_fit();
+}
+
+void RowBuffer::appendRow(const RowScratch& row) {
+    for (size_t c = 0; c < columns.size(); ++c) {
+        Column& col = columns[c];
+        CellKind k = row.kind(c);
+
+        if (k != CellKind::EMPTY) {
+            if (col.kind == CellKind::EMPTY) {
+                col.commit(k, rowCount, reserveHint);
+            } else if (k != col.kind && col.kind != CellKind::TEXT) {
+                col.promoteToText();
+            }
+        }
+
+        switch (col.kind) {
+            case CellKind::EMPTY:
+                // No value seen in this column yet; nothing stored per row
+                break;
+            case CellKind::TEXT:
+                col.offsets.push_back(col.bytes.size());
+                if (k == CellKind::TEXT) {
+                    col.bytes += row.text(c);
+                } else if (k == CellKind::INT64) {
+                    fastfmt::appendInt(col.bytes, row.intValue(c));
+                } else if (k == CellKind::BOOL) {
+                    col.bytes += row.intValue(c) ? "true" : "false";
+                }
+                break;
+            case CellKind::INT64:
+            case CellKind::BOOL:
+                col.values.push_back(row.intValue(c));
+                col.present.push_back(k == CellKind::EMPTY ? 0 : 1);
+                break;
+        }
+    }
+    rowCount++;
+}
+
+size_t RowBuffer::bytesUsed() const {
+    size_t total = 0;
+    for (const auto& col : columns) {
+        total += col.bytes.size() + col.offsets.size() * sizeof(size_t);
+        total += col.values.size() * sizeof(long long) + col.present.size();
+    }
+    return total;
+}
+
+void RowBuffer::clear() {
+    for (auto& col : columns) {
+        col.bytes.clear();
+        col.offsets.clear();
+        col.values.clear();
+        col.present.clear();
+    }
+    rowCount = 0;
+}
+
+void RowBuffer::formatRow(size_t row, std::string& line) const {
+    for (size_t c = 0; c < columns.size(); ++c) {
+        if (c > 0) line += " , ";
+        const Column& col = columns[c];
+        switch (col.kind) {
+            case CellKind::EMPTY:
+                break;
+            case CellKind::TEXT: {
+                size_t begin = col.offsets[row];
+                size_t end = row + 1 < col.offsets.size() ? col.offsets[row + 1]
+                                                          : col.bytes.size();
+                line.append(col.bytes.data() + begin, end - begin);
+                break;
+            }
+            case CellKind::INT64:
+                if (col.present[row]) {
+                    fastfmt::appendInt(line, col.values[row]);
+                }
+                break;
+            case CellKind::BOOL:
+                if (col.present[row]) {
+                    line += col.values[row] ? "true" : "false";
+                }
+                break;
+        }
+    }
+    line += '\n';
+}
+
+void TableSchema::rebuildColumnIndex() {
+    columnIndex.clear();
+    columnIndex.reserve(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        columnIndex.emplace(columns[i], static_cast<int>(i));
+    }
+    // The flat row buffer is addressed by the column count, which is final
+    // by the time the index is (re)built and rows start to land
+    rows.setWidth(columns.size());
+}
+
+int TableSchema::columnIndexOf(const std::string& column) const {
+    auto it = columnIndex.find(column);
+    return it == columnIndex.end() ? -1 : it->second;
+}
+
+int CSVGenerator::registerTable(const std::string& key, const std::shared_ptr<TableSchema>& schema) {
+    schema->key = key;
+    schema->fkColumn = getSingularForm(key) + "_id";
+    auto it = tableIds.find(key);
+    if (it != tableIds.end()) {
+        // Re-registration replaces the schema under the same id, matching
+        // the overwrite semantics of `tables[key] = schema`
+        schema->id = it->second;
+        tablesById[static_cast<size_t>(schema->id)] = schema;
+        return schema->id;
+    }
+    schema->id = static_cast<int>(tablesById.size());
+    tableIds.emplace(key, schema->id);
+    tablesById.push_back(schema);
+    mergeParent.push_back(schema->id);
+    return schema->id;
+}
+
+void CSVGenerator::applyProjection() {
+    if (tableFilter.empty() && columnFilter.empty()) return;
+
+    for (const auto& wanted : tableFilter) {
+        if (tables.find(wanted) == tables.end()) {
+            std::cerr << "Warning: --tables names unknown table '" << wanted << "'" << std::endl;
+        }
+    }
+    for (const auto& [wanted, cols] : columnFilter) {
+        if (tables.find(wanted) == tables.end()) {
+            std::cerr << "Warning: --columns names unknown table '" << wanted << "'" << std::endl;
+        }
+    }
+
+    for (auto& [key, schema] : tables) {
+        if (!tableFilter.empty() && tableFilter.find(key) == tableFilter.end()) {
+            schema->excluded = true;
+            continue;
+        }
+        auto colsIt = columnFilter.find(key);
+        if (colsIt == columnFilter.end()) continue;
+
+        const auto& keep = colsIt->second;
+        auto& columns = schema->columns;
+        columns.erase(std::remove_if(columns.begin(), columns.end(),
+                                     [&keep](const std::string& col) {
+                                         return keep.find(col) == keep.end();
+                                     }),
+                      columns.end());
+        schema->rebuildColumnIndex();
+    }
+}
+
+// Resolve the table and column positions for every scalar array the
+// analysis pass recorded. The row pass previously re-derived all of this
+// per array - a name concatenation, two special cases, a map lookup with
+// a linear fallback scan, and a derived foreign-key column name - even
+// though it is a pure function of schema-phase data.
+void CSVGenerator::compileScalarArrayEmitters() {
+    for (const auto& [parentTable, arrayKeys] : scalarArrayMappings) {
+        for (const auto& parentKey : arrayKeys) {
+            ScalarArraySlots& slots = scalarArraySlots[parentTable][parentKey];
+
+            std::string tableName = parentTable + "_" + parentKey;
+            if (parentKey == "genres" || parentKey == "genre") {
+                tableName = "genre";
+            } else if (parentKey == "tags") {
+                tableName = "tags";
+            }
+
+            auto tableIt = tables.find(tableName);
+            if (tableIt == tables.end()) {
+                for (const auto& [name, schema] : tables) {
+                    if (schema->name == tableName) {
+                        tableName = name;
+                        break;
+                    }
+                }
+                tableIt = tables.find(tableName);
+                if (tableIt == tables.end()) continue;
+            }
+            const auto& schema = tableIt->second;
+            if (schema->excluded) continue;
+
+            slots.tableId = schema->id;
+            slots.idIdx = schema->columnIndexOf("id");
+            slots.parentIdIdx = schema->columnIndexOf(getSingularForm(parentTable) + "_id");
+            if (slots.parentIdIdx < 0) {
+                slots.parentIdIdx = schema->columnIndexOf("parent_id");
+            }
+            slots.seqIdx = schema->columnIndexOf("seq");
+            if (slots.seqIdx < 0) {
+                slots.seqIdx = schema->columnIndexOf("index");
+            }
+            slots.valueIdx = schema->columnIndexOf("value");
+        }
+    }
+}
+
 CSVGenerator::CSVGenerator(std::string outputDir, bool streaming)
     : outputDir(std::move(outputDir)), streamingMode(streaming) {
 }
@@ -47,7 +324,7 @@ CSVGenerator::CSVGenerator(std::string outputDir, bool streaming)
 CSVGenerator::~CSVGenerator() {
     // Close any open file handles
     for (auto& pair : tableFiles) {
-        if (pair.second && pair.second->is_open()) {
+        if (pair.second) {
             pair.second->close();
         }
     }
@@ -56,10 +333,9 @@ CSVGenerator::~CSVGenerator() {
 std::string CSVGenerator::quoteCSVField(const std::string& field) {
     std::string trimmedField = trimString(field);
     
-    // If field contains comma, quote it
-    if (trimmedField.find(',') != std::string::npos || 
-        trimmedField.find('"') != std::string::npos || 
-        trimmedField.find('\n') != std::string::npos) {
+    // If field contains comma, quote it (single vector scan; most fields
+    // are clean and skip the per-character loop below entirely)
+    if (strkernels::needsCSVQuoting(trimmedField.data(), trimmedField.size())) {
         
         std::string result = "\"";
         for (char c : trimmedField) {
@@ -76,64 +352,144 @@ std::string CSVGenerator::quoteCSVField(const std::string& field) {
     return trimmedField;
 }
 
-void CSVGenerator::writeTableRow(const std::string& tableName, const std::vector<std::string>& row) {
-    auto fileIt = tableFiles.find(tableName);
-    
+void CSVGenerator::writeTableRow(int tableId, const RowScratch& row) {
+    if (tableId < 0) return;
+    if (filesById.size() < tablesById.size()) {
+        filesById.resize(tablesById.size(), nullptr);
+    }
+    auto& schema = tablesById[static_cast<size_t>(tableId)];
+    BufferedCSVWriter* writer = filesById[static_cast<size_t>(tableId)];
+
     // If file not open yet, open it
-    if (fileIt == tableFiles.end()) {
-        if (!outputDir.empty()) {
-            std::string filename = outputDir + "/" + tableName + ".csv";
-            auto file = std::make_unique<std::ofstream>(filename);
-            
-            if (!file->is_open()) {
-                std::cerr << "Error: Could not open file " << filename << std::endl;
-                return;
-            }
-            
-            tableFiles[tableName] = std::move(file);
-        } else {
+    if (!writer) {
+        if (outputDir.empty()) {
             std::cerr << "Error: No output directory specified" << std::endl;
             return;
         }
-        
+        std::string filename = outputPath(schema->key);
+        auto file = std::make_unique<BufferedCSVWriter>(
+            filename, BufferedCSVWriter::DEFAULT_BUFFER_SIZE, /*async=*/true,
+            compression);
+
+        if (!file->isOpen()) {
+            std::cerr << "Error: Could not open file " << filename << std::endl;
+            return;
+        }
+
+        writer = file.get();
+        filesById[static_cast<size_t>(tableId)] = writer;
+        tableFiles[schema->key] = std::move(file);
+
         // Write header if this is a new file
-        auto schemaIt = tables.find(tableName);
-        if (schemaIt != tables.end() && !schemaIt->second->columns.empty()) {
+        if (!schema->columns.empty()) {
             std::vector<std::string> quotedHeaders;
-            for (const auto& col : schemaIt->second->columns) {
+            for (const auto& col : schema->columns) {
                 quotedHeaders.push_back(trimString(col));
             }
-            
-            *tableFiles[tableName] << quotedHeaders[0];
-            for (size_t i = 1; i < quotedHeaders.size(); ++i) {
-                *tableFiles[tableName] << " , " << quotedHeaders[i];
-            }
-            *tableFiles[tableName] << std::endl;
+
+            writer->writeRow(quotedHeaders);
         }
     }
-    
-    // Write the row
-    if (row.size() > 0) {
-        *tableFiles[tableName] << row[0];
-        for (size_t i = 1; i < row.size(); ++i) {
-            *tableFiles[tableName] << " , " << row[i];
+
+    // Render the typed cells and write the row
+    std::vector<std::string> rendered(row.width());
+    for (size_t i = 0; i < row.width(); ++i) {
+        row.renderCell(i, rendered[i]);
+    }
+    writer->writeRow(rendered);
+    // Folded into runStats per table when the stream finishes; touching the
+    // string-keyed stats map per row is exactly the lookup this path sheds
+    schema->emittedRows++;
+}
+
+// Recursive shape of one record: object keys (sorted) each followed by the
+// shape of their value, the first element's shape for arrays, and a bare
+// marker for scalars. Cached schemas cover nested tables too, so the guard
+// has to see the whole shape — matching only the top-level key set would
+// accept a cache whose nested column sets no longer fit the input.
+static void appendShapeSignature(AstNode* node, std::string& out) {
+    if (auto objNode = node->asObject()) {
+        std::vector<const KeyValuePair*> sorted;
+        sorted.reserve(objNode->pairs.size());
+        for (const auto& pair : objNode->pairs) {
+            sorted.push_back(&pair);
         }
-        *tableFiles[tableName] << std::endl;
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const KeyValuePair* a, const KeyValuePair* b) {
+                      return a->key->text < b->key->text;
+                  });
+        out += '{';
+        for (const auto* pair : sorted) {
+            out += pair->key->text;
+            out += ':';
+            appendShapeSignature(pair->value, out);
+            out += ',';
+        }
+        out += '}';
+    } else if (auto arrayNode = node->asArray()) {
+        out += '[';
+        if (!arrayNode->elements.empty()) {
+            appendShapeSignature(arrayNode->elements.front(), out);
+        }
+        out += ']';
+    } else {
+        out += '.';
     }
 }
 
+// Shape signature of the input root, used to validate the schema cache
+static std::string rootShapeSignature(AstNode* root) {
+    std::string signature;
+    if (root->asObject()) {
+        appendShapeSignature(root, signature);
+    } else if (auto arrayNode = root->asArray()) {
+        // Mixed and scalar root arrays keep an empty signature, which
+        // disables the cache path as before
+        if (arrayNode->isArrayOfObjects()) {
+            appendShapeSignature(arrayNode->elements.front(), signature);
+        }
+    }
+    return signature;
+}
+
 void CSVGenerator::generateCSV(const AST& ast) {
     auto root = ast.getRoot();
     if (!root) return;
+
+    // Incremental re-run: when every top-level record hashes the same as
+    // the previous run and its output files are still in place, the CSVs
+    // are already correct — skip the whole pipeline
+    if (deltaMode) {
+        computeRecordHashes(root);
+        if (deltaUnchanged()) {
+            std::cerr << "Delta: input unchanged since last run, keeping existing CSV files" << std::endl;
+            return;
+        }
+    }
+
+    auto analyzeStart = std::chrono::steady_clock::now();
+    std::string signature = rootShapeSignature(root);
+    bool cacheHit = !schemaCachePath.empty() && !signature.empty() &&
+                    loadSchemaCache(signature);
     
-    // First pass: analyze the structure
-    analyzeAst(root);
-    
-    // Rename tables based on content
-    renameTablesBasedOnContent();
-    
-    // Process foreign key relationships
-    processRelationships();
+    if (cacheHit) {
+        // Schemas are already resolved; the tree still needs its
+        // parent/table links stamped for the row pass
+        if (auto objNode = root->asObject()) {
+            analyzeObject(objNode, false);
+        } else if (auto arrayNode = root->asArray()) {
+            analyzeArray(arrayNode, "root", false);
+        }
+    } else {
+        // First pass: analyze the structure
+        analyzeAst(root);
+        
+        // Rename tables based on content
+        renameTablesBasedOnContent();
+        
+        // Process foreign key relationships
+        processRelationships();
+    }
     
     // Add ID columns to all tables
     for (const auto& tablePair : tables) {
@@ -153,90 +509,549 @@ void CSVGenerator::generateCSV(const AST& ast) {
         if (it != schema->columns.end()) {
             schema->columns.erase(it);
         }
+        
+        schema->rebuildColumnIndex();
+    }
+    
+    if (!cacheHit && !schemaCachePath.empty() && !signature.empty()) {
+        saveSchemaCache(signature);
     }
+
+    // Drop filtered tables/columns now that the schemas are final (and
+    // safely after the cache write, so cached schemas stay unprojected)
+    applyProjection();
+    compileScalarArrayEmitters();
+    
+    runStats().analyzeMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - analyzeStart).count();
+    auto generateStart = std::chrono::steady_clock::now();
     
     // Setup streaming mode if needed
     if (streamingMode) {
-        for (const auto& tablePair : tables) {
-            const std::string& tableName = tablePair.first;
-            const auto& schema = tablePair.second;
-            
-            std::string filename;
-            if (!outputDir.empty()) {
-                filename = outputDir + "/" + tableName + ".csv";
-            } else {
-                filename = tableName + ".csv";
-            }
-            
-            std::unique_ptr<std::ofstream> file = std::make_unique<std::ofstream>(filename);
-            if (!file->is_open()) {
-                std::cerr << "Error: Could not open file " << filename << std::endl;
-                continue;
-            }
-            
-            // Write headers
-            if (!schema->columns.empty()) {
-                *file << schema->columns[0];
-                for (size_t i = 1; i < schema->columns.size(); ++i) {
-                    *file << " , " << schema->columns[i];
-                }
-                *file << std::endl;
-            }
-            
-            tableFiles[tableName] = std::move(file);
-        }
+        setupStreamingOutput();
     }
     
     // Second pass: generate actual CSV data
     generateRowsFromAst(root);
     
-    // If not in streaming mode, write all tables at once
+    // If not in streaming mode, write all tables at once. The per-table row
+    // vectors are fully independent by now, so distinct tables are written
+    // by concurrent workers pulling from a shared queue.
     if (!streamingMode) {
+        std::vector<std::pair<std::string, TableSchema*>> writeQueue;
+        writeQueue.reserve(tables.size());
         for (const auto& tablePair : tables) {
-            const std::string& tableName = tablePair.first;
-            const auto& schema = tablePair.second;
+            if (tablePair.second->excluded) continue;
+            writeQueue.emplace_back(tablePair.first, tablePair.second.get());
+        }
+        
+        // Bytes written per table, collected by the workers and folded into
+        // the shared stats only after they join
+        std::vector<unsigned long long> bytesWritten(writeQueue.size(), 0);
+        
+        auto writeTable = [&](size_t queueIndex) {
+            const std::string& tableName = writeQueue[queueIndex].first;
+            const TableSchema* schema = writeQueue[queueIndex].second;
             
-            std::string filename;
-            if (!outputDir.empty()) {
-                filename = outputDir + "/" + tableName + ".csv";
-            } else {
-                filename = tableName + ".csv";
-            }
+            std::string filename = outputPath(tableName);
             
-            std::ofstream outfile(filename);
-            if (!outfile.is_open()) {
+            // Async double-buffering: formatRow fills one buffer while
+            // the writer's I/O thread drains the other (each writer also
+            // owns its own deflate context, so tables compress in parallel)
+            BufferedCSVWriter outfile(filename, BufferedCSVWriter::DEFAULT_BUFFER_SIZE,
+                                      /*async=*/true, compression);
+            if (!outfile.isOpen()) {
                 std::cerr << "Error: Could not open file " << filename << std::endl;
-                continue;
+                return;
+            }
+
+            if (outputFormat == OutputFormat::COLUMNAR) {
+                // Column names travel in the file's footer, and the rows go
+                // out as the RowBuffer's own column chunks - no per-row
+                // formatting at all
+                columnar::writeTable(outfile, schema->columns, schema->rows);
+                outfile.close();
+                bytesWritten[queueIndex] = outfile.bytesWritten();
+                return;
             }
             
             // Write headers
             if (!schema->columns.empty()) {
-                outfile << schema->columns[0];
-                for (size_t i = 1; i < schema->columns.size(); ++i) {
-                    outfile << " , " << schema->columns[i];
-                }
-                outfile << std::endl;
+                outfile.writeRow(schema->columns);
             }
-            
-            // Write rows
-            for (const auto& row : schema->rows) {
-                if (!row.empty()) {
-                    outfile << row[0];
-                    for (size_t i = 1; i < row.size(); ++i) {
-                        outfile << " , " << row[i];
+
+            // Stream back any spilled rows first; they were buffered (and
+            // spooled) before everything still resident in `rows`
+            if (schema->spilledRows > 0) {
+                std::ifstream spool(spoolPath(tableName), std::ios::binary);
+                if (spool.is_open()) {
+                    char chunk[1 << 16];
+                    while (spool.read(chunk, sizeof(chunk)) || spool.gcount() > 0) {
+                        outfile.writeRaw(chunk, static_cast<size_t>(spool.gcount()));
                     }
-                    outfile << std::endl;
+                    spool.close();
+                    fs::remove(spoolPath(tableName));
+                } else {
+                    std::cerr << "Error: could not read spool file "
+                              << spoolPath(tableName) << std::endl;
                 }
             }
+
+            // Write rows straight out of the flat buffer
+            std::string line;
+            for (size_t r = 0; r < schema->rows.size(); ++r) {
+                line.clear();
+                schema->rows.formatRow(r, line);
+                outfile.writeRaw(line.data(), line.size());
+            }
             
             outfile.close();
+            bytesWritten[queueIndex] = outfile.bytesWritten();
+        };
+        
+        int workers = threadCount > 0 ? threadCount
+                                      : static_cast<int>(std::thread::hardware_concurrency());
+        if (static_cast<size_t>(workers) > writeQueue.size()) {
+            workers = static_cast<int>(writeQueue.size());
+        }
+        
+        if (workers > 1) {
+            std::atomic<size_t> nextTable{0};
+            std::vector<std::thread> pool;
+            pool.reserve(workers);
+            for (int w = 0; w < workers; ++w) {
+                pool.emplace_back([&]() {
+                    for (size_t i = nextTable.fetch_add(1); i < writeQueue.size();
+                         i = nextTable.fetch_add(1)) {
+                        writeTable(i);
+                    }
+                });
+            }
+            for (auto& t : pool) {
+                t.join();
+            }
+        } else {
+            for (size_t i = 0; i < writeQueue.size(); ++i) {
+                writeTable(i);
+            }
+        }
+        
+        for (size_t i = 0; i < writeQueue.size(); ++i) {
+            runStats().tables[writeQueue[i].first].rows +=
+                writeQueue[i].second->spilledRows + writeQueue[i].second->rows.size();
+            runStats().tables[writeQueue[i].first].bytes = bytesWritten[i];
         }
     }
     
     // Close any open files
     for (auto& pair : tableFiles) {
-        if (pair.second && pair.second->is_open()) {
+        if (pair.second) {
             pair.second->close();
+            runStats().tables[pair.first].bytes = pair.second->bytesWritten();
+        }
+    }
+    
+    runStats().generateMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - generateStart).count();
+
+    if (deltaMode) {
+        saveDeltaState();
+    }
+}
+
+// --- External spill (batch mode) ---
+
+std::string CSVGenerator::outputPath(const std::string& tableKey) const {
+    std::string path = outputDir.empty() ? tableKey : outputDir + "/" + tableKey;
+    path += outputFormat == OutputFormat::COLUMNAR ? ".colbin" : ".csv";
+    if (compression == CSVCompression::GZIP) {
+        path += ".gz";
+    }
+    return path;
+}
+
+std::string CSVGenerator::spoolPath(const std::string& tableKey) const {
+    if (outputDir.empty()) {
+        return "." + tableKey + ".spool";
+    }
+    return outputDir + "/." + tableKey + ".spool";
+}
+
+void CSVGenerator::maybeSpillRows(TableSchema& schema) {
+    if (spillBudget == 0 || schema.rows.bytesUsed() < spillBudget) return;
+
+    // Spool files hold pre-rendered CSV row text, which the columnar
+    // backend cannot consume; main.cpp warns when both flags are given
+    if (outputFormat == OutputFormat::COLUMNAR) return;
+
+    // Truncate on the first spill of the run: a spool left behind by a
+    // crashed or killed previous run must not be replayed into this one
+    auto mode = schema.spilledRows == 0 ? std::ios::trunc : std::ios::app;
+    std::ofstream out(spoolPath(schema.key), mode | std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Warning: could not open spool file " << spoolPath(schema.key)
+                  << ", keeping rows resident" << std::endl;
+        return;
+    }
+
+    std::string line;
+    for (size_t r = 0; r < schema.rows.size(); ++r) {
+        line.clear();
+        schema.rows.formatRow(r, line);
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+    schema.spilledRows += schema.rows.size();
+    schema.rows.clear();
+}
+
+// --- Incremental re-run (--delta) ---
+//
+// State file format, written next to the CSVs:
+//
+//   json2relcsv-delta 1
+//   records <count>
+//   <one hash per line, hex, in root-array order>
+//   files <count>
+//   <one output filename per line>
+
+// 64-bit FNV-1a, fed a subtree's structure and scalar text. Type tags go
+// into the hash ahead of every node, so reordered or retyped fields hash
+// differently even when their text matches.
+static void hashBytes(unsigned long long& h, const char* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+}
+
+static void hashNode(unsigned long long& h, AstNode* node) {
+    char tag = static_cast<char>('0' + static_cast<int>(node->getType()));
+    hashBytes(h, &tag, 1);
+    switch (node->getType()) {
+        case NodeType::OBJECT:
+            for (const auto& pair : node->asObject()->pairs) {
+                hashBytes(h, pair.key->text.data(), pair.key->text.size());
+                hashNode(h, pair.value);
+            }
+            break;
+        case NodeType::ARRAY:
+            for (auto* elem : node->asArray()->elements) {
+                hashNode(h, elem);
+            }
+            break;
+        case NodeType::STRING: {
+            const std::string& value = node->asString()->str();
+            hashBytes(h, value.data(), value.size());
+            break;
+        }
+        case NodeType::NUMBER: {
+            const std::string& value = node->asNumber()->toString();
+            hashBytes(h, value.data(), value.size());
+            break;
+        }
+        case NodeType::BOOLEAN: {
+            char v = node->asBoolean()->value ? 't' : 'f';
+            hashBytes(h, &v, 1);
+            break;
+        }
+        case NodeType::NULL_VALUE:
+            break;
+    }
+}
+
+std::string CSVGenerator::deltaStatePath() const {
+    if (outputDir.empty()) {
+        return ".json2relcsv.delta";
+    }
+    return outputDir + "/.json2relcsv.delta";
+}
+
+void CSVGenerator::computeRecordHashes(AstNode* root) {
+    recordHashes.clear();
+    if (auto arrayNode = root->asArray()) {
+        recordHashes.reserve(arrayNode->elements.size());
+        for (auto* elem : arrayNode->elements) {
+            unsigned long long h = 1469598103934665603ULL;
+            hashNode(h, elem);
+            recordHashes.push_back(h);
+        }
+        return;
+    }
+    unsigned long long h = 1469598103934665603ULL;
+    hashNode(h, root);
+    recordHashes.push_back(h);
+}
+
+bool CSVGenerator::deltaUnchanged() const {
+    std::ifstream in(deltaStatePath());
+    if (!in.is_open()) return false;
+
+    std::string line;
+    if (!std::getline(in, line) || line != "json2relcsv-delta 1") return false;
+    if (!std::getline(in, line) || line.rfind("records ", 0) != 0) return false;
+    size_t count = static_cast<size_t>(std::atoll(line.c_str() + 8));
+    if (count != recordHashes.size()) return false;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!std::getline(in, line)) return false;
+        if (std::strtoull(line.c_str(), nullptr, 16) != recordHashes[i]) return false;
+    }
+
+    if (!std::getline(in, line) || line.rfind("files ", 0) != 0) return false;
+    size_t fileCount = static_cast<size_t>(std::atoll(line.c_str() + 6));
+    for (size_t i = 0; i < fileCount; ++i) {
+        if (!std::getline(in, line)) return false;
+        if (!fs::exists(line)) return false;
+    }
+    return fileCount > 0;
+}
+
+void CSVGenerator::saveDeltaState() const {
+    std::ofstream out(deltaStatePath());
+    if (!out.is_open()) {
+        std::cerr << "Warning: could not write delta state " << deltaStatePath() << std::endl;
+        return;
+    }
+
+    out << "json2relcsv-delta 1\n";
+    out << "records " << recordHashes.size() << "\n";
+    out << std::hex;
+    for (unsigned long long h : recordHashes) {
+        out << h << "\n";
+    }
+    out << std::dec;
+    size_t fileCount = 0;
+    for (const auto& tablePair : tables) {
+        if (!tablePair.second->excluded) ++fileCount;
+    }
+    out << "files " << fileCount << "\n";
+    for (const auto& tablePair : tables) {
+        if (tablePair.second->excluded) continue;
+        out << outputPath(tablePair.first) << "\n";
+    }
+}
+
+// Schema cache format: a line-based text file holding the resolved table
+// schemas and merge decisions, guarded by the shape signature of the input
+// they were derived from.
+//
+//   json2relcsv-schema-cache 2
+//   signature <root shape signature>
+//   table <column count>
+//   <table key>
+//   <table display name>
+//   <one column per line>
+//   merged <source table key> <target table key>
+
+bool CSVGenerator::loadSchemaCache(const std::string& signature) {
+    std::ifstream in(schemaCachePath);
+    if (!in.is_open()) return false;
+
+    std::string line;
+    if (!std::getline(in, line) || line != "json2relcsv-schema-cache 2") return false;
+    if (!std::getline(in, line) || line != "signature " + signature) return false;
+
+    std::map<std::string, std::shared_ptr<TableSchema>> loaded;
+    std::vector<std::pair<std::string, std::string>> loadedMerges;
+    while (std::getline(in, line)) {
+        if (line.rfind("table ", 0) == 0) {
+            int columnCount = std::atoi(line.c_str() + 6);
+            auto schema = std::make_shared<TableSchema>();
+            std::string key;
+            if (!std::getline(in, key)) return false;
+            if (!std::getline(in, schema->name)) return false;
+            for (int i = 0; i < columnCount; ++i) {
+                std::string column;
+                if (!std::getline(in, column)) return false;
+                schema->columns.push_back(column);
+            }
+            loaded[key] = schema;
+        } else if (line.rfind("merged ", 0) == 0) {
+            std::string entry = line.substr(7);
+            size_t space = entry.find(' ');
+            if (space == std::string::npos) return false;
+            loadedMerges.emplace_back(entry.substr(0, space), entry.substr(space + 1));
+        } else if (!line.empty()) {
+            return false;
+        }
+    }
+
+    // Validate the merge entries against the parsed tables before touching
+    // member state, so a corrupted cache leaves the generator untouched and
+    // the caller falls back to a fresh analysis
+    for (const auto& [source, target] : loadedMerges) {
+        if (loaded.find(source) == loaded.end() ||
+            loaded.find(target) == loaded.end()) {
+            return false;
+        }
+    }
+
+    tables = std::move(loaded);
+    mergedTables.clear();
+    tablesById.clear();
+    tableIds.clear();
+    mergeParent.clear();
+    for (const auto& [key, schema] : tables) {
+        registerTable(key, schema);
+    }
+    // Re-link the union-find; the cached columns already carry the fk
+    // renames, so mergeUnite's rename pass is a no-op here
+    for (const auto& [source, target] : loadedMerges) {
+        mergeUnite(tableIds[source], tableIds[target]);
+    }
+    return true;
+}
+
+void CSVGenerator::saveSchemaCache(const std::string& signature) const {
+    std::ofstream out(schemaCachePath);
+    if (!out.is_open()) {
+        std::cerr << "Warning: could not write schema cache " << schemaCachePath << std::endl;
+        return;
+    }
+
+    out << "json2relcsv-schema-cache 2\n";
+    out << "signature " << signature << "\n";
+    for (const auto& [key, schema] : tables) {
+        out << "table " << schema->columns.size() << "\n";
+        out << key << "\n";
+        out << schema->name << "\n";
+        for (const auto& column : schema->columns) {
+            out << column << "\n";
+        }
+    }
+    for (const auto& name : mergedTables) {
+        auto idIt = tableIds.find(name);
+        if (idIt == tableIds.end()) continue;
+        out << "merged " << name << " "
+            << tablesById[static_cast<size_t>(mergeFind(idIt->second))]->key << "\n";
+    }
+}
+
+// Open per-table output files and write headers (streaming mode)
+void CSVGenerator::setupStreamingOutput() {
+    for (const auto& tablePair : tables) {
+        const std::string& tableName = tablePair.first;
+        const auto& schema = tablePair.second;
+        if (schema->excluded) continue;
+
+        std::string filename = outputPath(tableName);
+
+        // Parsing and row generation overlap the disk writes from here on
+        auto file = std::make_unique<BufferedCSVWriter>(
+            filename, BufferedCSVWriter::DEFAULT_BUFFER_SIZE, /*async=*/true,
+            compression);
+        if (!file->isOpen()) {
+            std::cerr << "Error: Could not open file " << filename << std::endl;
+            continue;
+        }
+
+        // Write headers
+        if (!schema->columns.empty()) {
+            file->writeRow(schema->columns);
+        }
+
+        if (filesById.size() < tablesById.size()) {
+            filesById.resize(tablesById.size(), nullptr);
+        }
+        if (schema->id >= 0) {
+            filesById[static_cast<size_t>(schema->id)] = file.get();
+        }
+        tableFiles[tableName] = std::move(file);
+    }
+}
+
+// The streaming schema is fixed by the first record (or first document in
+// --ndjson mode), and output files cannot be opened retroactively, so a
+// table whose first occurrence comes later loses all of its rows. That is
+// inherent to single-pass streaming, but it must not happen silently —
+// say so once per table.
+void CSVGenerator::warnDroppedTable(const std::string& tableName) {
+    if (!droppedTablesWarned.insert(tableName).second) return;
+    std::cerr << "Warning: table '" << tableName
+              << "' first appears after the first record; streaming mode "
+              << "fixes the schema up front, so its rows are dropped "
+              << "(re-run without --stream/--ndjson to keep them)" << std::endl;
+}
+
+// Consume one completed top-level array element in streaming input mode.
+// The first record drives schema analysis and opens the output files; later
+// records are only annotated with parent/table links and emitted directly.
+void CSVGenerator::consumeTopLevelValue(AstNode* node) {
+    if (!node) return;
+
+    if (node->getType() != NodeType::OBJECT) {
+        if (!streamSkippedWarned) {
+            std::cerr << "Warning: skipping non-object top-level array element in streaming mode" << std::endl;
+            streamSkippedWarned = true;
+        }
+        return;
+    }
+
+    auto objNode = node->asObject();
+
+    if (!streamInitialized) {
+        analyzeObject(objNode);
+        renameTablesBasedOnContent();
+        processRelationships();
+
+        // Ensure columns list starts with 'id', as in batch mode
+        for (const auto& tablePair : tables) {
+            auto& schema = tablePair.second;
+            auto it = std::find(schema->columns.begin(), schema->columns.end(), "id");
+            if (it != schema->columns.begin()) {
+                if (it != schema->columns.end()) {
+                    schema->columns.erase(it);
+                }
+                schema->columns.insert(schema->columns.begin(), "id");
+            }
+            it = std::find(schema->columns.begin(), schema->columns.end(), "root_id");
+            if (it != schema->columns.end()) {
+                schema->columns.erase(it);
+            }
+            
+            schema->rebuildColumnIndex();
+        }
+
+        applyProjection();
+        compileScalarArrayEmitters();
+
+        setupStreamingOutput();
+        streamInitialized = true;
+    } else {
+        analyzeObject(objNode, false);
+    }
+
+    generateRowsFromObject(objNode);
+}
+
+// Consume one complete top-level document in NDJSON mode (see the header
+// comment). Array elements that streamed through consumeTopLevelValue
+// during the parse have already been emitted, so iterating whatever is
+// left in the array covers both the streamed and the buffered case.
+void CSVGenerator::consumeDocument(AstNode* node) {
+    if (!node) return;
+
+    if (node->getType() == NodeType::ARRAY) {
+        for (auto* elem : node->asArray()->elements) {
+            consumeTopLevelValue(elem);
+        }
+        return;
+    }
+
+    consumeTopLevelValue(node);
+}
+
+// Flush and close the output files opened by streaming mode
+void CSVGenerator::finishStreaming() {
+    for (const auto& schema : tablesById) {
+        if (schema->emittedRows > 0) {
+            runStats().tables[schema->key].rows += schema->emittedRows;
+        }
+    }
+    for (auto& pair : tableFiles) {
+        if (pair.second) {
+            pair.second->close();
+            runStats().tables[pair.first].bytes = pair.second->bytesWritten();
         }
     }
 }
@@ -275,67 +1090,81 @@ void CSVGenerator::processRelationships() {
             }
         }
     }
-    
-    // Merge similar tables (e.g. users from author and comments)
-    std::map<std::string, std::set<std::string>> tableSignatures;
-    for (const auto& [name, schema] : tables) {
-        std::set<std::string> columns(schema->columns.begin(), schema->columns.end());
-        std::string signature;
-        for (const auto& col : columns) {
-            if (col != "id" && !(col.size() >= 3 && col.compare(col.size() - 3, 3, "_id") == 0)) {
-                signature += col + ",";
-            }
-        }
-        if (!signature.empty() && signature != "index,value," && signature != "seq,value,") {
-            tableSignatures[signature].insert(name);
-        }
+
+    // Merge tables with equivalent shapes (e.g. users reached as both an
+    // author object and comment authors)
+    unifyEquivalentShapes();
+}
+
+int CSVGenerator::mergeFind(int id) const {
+    while (mergeParent[static_cast<size_t>(id)] != id) {
+        id = mergeParent[static_cast<size_t>(id)];
     }
-    
-    // Tables that could be merged based on similar structure
-    std::map<std::string, std::vector<std::string>> similarTables;
-    for (const auto& [signature, tableNames] : tableSignatures) {
-        if (tableNames.size() > 1) {
-            // Take the first table as the "main" one
-            std::vector<std::string> tables(tableNames.begin(), tableNames.end());
-            similarTables[*tableNames.begin()] = std::vector<std::string>(++tableNames.begin(), tableNames.end());
-        }
+    return id;
+}
+
+void CSVGenerator::mergeUnite(int sourceId, int targetId) {
+    int source = mergeFind(sourceId);
+    int target = mergeFind(targetId);
+    if (source == target) return;
+    mergeParent[static_cast<size_t>(source)] = target;
+
+    const auto& sourceSchema = tablesById[static_cast<size_t>(source)];
+    const auto& targetSchema = tablesById[static_cast<size_t>(target)];
+
+    // Foreign keys that named the source now name the target. This runs
+    // before the column indexes are built, so it works on the raw column
+    // lists - but only for the rare table pair that actually merges, not
+    // as a sweep over every pair like the old signature comparison.
+    // Tables that already point at the target keep their own fk column
+    // (two same-shaped siblings under one parent stay distinguishable).
+    for (const auto& [key, schema] : tables) {
+        auto& cols = schema->columns;
+        if (std::find(cols.begin(), cols.end(), targetSchema->fkColumn) != cols.end()) continue;
+        std::replace(cols.begin(), cols.end(), sourceSchema->fkColumn, targetSchema->fkColumn);
     }
-    
-    // For Test 4 - handle users in author and comments
-    auto usersIt = std::find_if(tables.begin(), tables.end(), 
-                             [](const auto& pair) { 
-                                 return pair.first == "users" || pair.second->name == "users"; 
-                             });
-
-    auto authorsIt = std::find_if(tables.begin(), tables.end(), 
-                               [](const auto& pair) { 
-                                   return pair.first == "authors" || pair.second->name == "authors"; 
-                               });
-    
-    if (usersIt != tables.end() && authorsIt != tables.end()) {
-        // Merge authors into users
-        mergeTable(authorsIt->first, usersIt->first);
+
+    // The source emits no rows and no file of its own from here on
+    sourceSchema->excluded = true;
+    mergedTables.insert(sourceSchema->key);
+}
+
+std::string CSVGenerator::shapeSignature(const TableSchema& schema) {
+    // Structural columns (ids, foreign keys, sequence positions) say where
+    // a table sits, not what it holds, so they do not distinguish shapes
+    std::set<std::string> names;
+    for (const auto& col : schema.columns) {
+        if (col == "id" || col == "seq" || col == "index") continue;
+        if (col.size() >= 3 && col.compare(col.size() - 3, 3, "_id") == 0) continue;
+        names.insert(col);
+    }
+
+    std::string signature;
+    for (const auto& name : names) {
+        signature += name;
+        signature += ',';
     }
+    // A bare value column is every scalar-array table; never merge on it
+    if (signature == "value,") return "";
+    return signature;
 }
 
-// Merge one table into another
-void CSVGenerator::mergeTable(const std::string& sourceTable, const std::string& targetTable) {
-    auto sourceIt = tables.find(sourceTable);
-    auto targetIt = tables.find(targetTable);
-    
-    if (sourceIt == tables.end() || targetIt == tables.end()) return;
-    
-    // Update foreign keys that refer to the source table
-    for (auto& tablePair : tables) {
-        for (auto& column : tablePair.second->columns) {
-            if (column == sourceTable + "_id") {
-                column = targetTable + "_id";
-            }
+void CSVGenerator::unifyEquivalentShapes() {
+    // Dense ids are assigned in registration order, so walking them keeps
+    // the first-seen table as the representative its equivalents join
+    for (const auto& schema : tablesById) {
+        if (!schema || schema->excluded) continue;
+        // A top-level array registers a twin table under the empty key
+        // whose shape mirrors the real element table; merging the pair
+        // would strand the rows, so the artifact never enters the registry
+        if (schema->key.empty()) continue;
+        std::string signature = shapeSignature(*schema);
+        if (signature.empty()) continue;
+        auto [it, inserted] = shapeRegistry.emplace(std::move(signature), schema->id);
+        if (!inserted) {
+            mergeUnite(schema->id, it->second);
         }
     }
-    
-    // Mark the source table as merged
-    mergedTables.insert(sourceTable);
 }
 
 
@@ -399,6 +1228,7 @@ void CSVGenerator::renameTablesBasedOnContent() {
 std::vector<std::string> CSVGenerator::getTableNames() const {
     std::vector<std::string> names;
     for (const auto& pair : tables) {
+        if (pair.second->excluded) continue;
         if (mergedTables.find(pair.first) == mergedTables.end()) {
             names.push_back(pair.second->name);
         }
@@ -406,27 +1236,18 @@ std::vector<std::string> CSVGenerator::getTableNames() const {
     return names;
 }
 
-std::string CSVGenerator::getTableNameForObjectShape(const std::string& signature) {
-    // If called with empty signature (root object), default to "root" and rename later
-    if (signature.empty() || signature == "_ROOT_") {
-        return "root";
-    }
-    // Use parentKey or signature analysis later in renaming
-    return "temp_" + signature; // Temporary name, refined in renameTablesBasedOnContent
-}
-
-void CSVGenerator::analyzeAst(const std::shared_ptr<AstNode>& node) {
+void CSVGenerator::analyzeAst(AstNode* node) {
     if (!node) return;
     
     // Process based on node type
     if (node->getType() == NodeType::OBJECT) {
-        auto objNode = std::dynamic_pointer_cast<ObjectNode>(node);
+        auto objNode = node->asObject();
         if (objNode) {
             analyzeObject(objNode);
         }
     }
     else if (node->getType() == NodeType::ARRAY) {
-        auto arrayNode = std::dynamic_pointer_cast<ArrayNode>(node);
+        auto arrayNode = node->asArray();
         if (arrayNode) {
             analyzeArray(arrayNode, "root");
         }
@@ -434,69 +1255,90 @@ void CSVGenerator::analyzeAst(const std::shared_ptr<AstNode>& node) {
     // Other node types don't need analysis
 }
 
-void CSVGenerator::analyzeObject(const std::shared_ptr<ObjectNode>& objNode) {
+void CSVGenerator::analyzeObject(ObjectNode* objNode, bool registerSchema) {
     if (!objNode) return;
     
+    // Stamp the row id here instead of in a separate tree pass; the analyze
+    // walk visits objects in the same pre-order the old pass used
+    objNode->id = nextRowId++;
+    
     std::string tableName = objNode->parentKey.empty() ? "root" : objNode->parentKey;
     objNode->tableName = tableName;
 
-    auto tableIt = tables.find(tableName);
-    if (tableIt == tables.end()) {
-        auto schema = std::make_shared<TableSchema>();
-        schema->name = tableName;
-        schema->columns.push_back("id");
-        for (const auto& pair : objNode->pairs) {
-            if (pair.value->getType() != NodeType::OBJECT && pair.value->getType() != NodeType::ARRAY) {
-                schema->columns.push_back(trimString(pair.key));
+    if (registerSchema) {
+        auto tableIt = tables.find(tableName);
+        if (tableIt == tables.end()) {
+            auto schema = std::make_shared<TableSchema>();
+            schema->name = tableName;
+            schema->columns.push_back("id");
+            for (const auto& pair : objNode->pairs) {
+                if (pair.value->getType() != NodeType::OBJECT && pair.value->getType() != NodeType::ARRAY) {
+                    schema->columns.push_back(pair.key->trimmed);
+                }
             }
+            tables[tableName] = schema;
+            registerTable(tableName, schema);
         }
-        tables[tableName] = schema;
+    }
+
+    // O(1) handle for the row pass
+    auto idIt = tableIds.find(tableName);
+    objNode->tableId = idIt == tableIds.end() ? -1 : idIt->second;
+
+    if (!registerSchema && objNode->tableId < 0) {
+        warnDroppedTable(tableName);
     }
 
     for (const auto& pair : objNode->pairs) {
         if (pair.value->getType() == NodeType::OBJECT) {
-            auto nestedObj = std::dynamic_pointer_cast<ObjectNode>(pair.value);
+            auto nestedObj = pair.value->asObject();
             nestedObj->parentTable = tableName;
-            nestedObj->parentKey = trimString(pair.key);
+            nestedObj->parentKey = pair.key->trimmed;
             nestedObj->parentId = objNode->id;
-            analyzeObject(nestedObj);
-            std::string fkCol = getSingularForm(nestedObj->tableName) + "_id";
-            tables[tableName]->columns.push_back(fkCol);
+            analyzeObject(nestedObj, registerSchema);
+            if (registerSchema) {
+                std::string fkCol = getSingularForm(nestedObj->tableName) + "_id";
+                tables[tableName]->columns.push_back(fkCol);
+            }
         } else if (pair.value->getType() == NodeType::ARRAY) {
-            auto arrayNode = std::dynamic_pointer_cast<ArrayNode>(pair.value);
+            auto arrayNode = pair.value->asArray();
             arrayNode->parentTable = tableName;
-            arrayNode->parentKey = trimString(pair.key);
+            arrayNode->parentKey = pair.key->trimmed;
             arrayNode->parentId = objNode->id;
-            analyzeArray(arrayNode, arrayNode->parentKey);
+            analyzeArray(arrayNode, arrayNode->parentKey, registerSchema);
         }
     }
 }
 
 
-void CSVGenerator::analyzeArray(const std::shared_ptr<ArrayNode>& arrayNode, const std::string& parentKey) {
+void CSVGenerator::analyzeArray(ArrayNode* arrayNode, const std::string& parentKey, bool registerSchema) {
     if (!arrayNode) return;
 
     if (arrayNode->isArrayOfObjects()) {
         std::string tableName = trimString(arrayNode->parentKey);
-        auto schema = std::make_shared<TableSchema>();
-        schema->name = tableName;
-        schema->columns = {"id", getSingularForm(arrayNode->parentTable) + "_id", "seq"};
-        tables[tableName] = schema;
-        objArrayMappings[arrayNode->parentTable].push_back(tableName);
+        if (registerSchema) {
+            auto schema = std::make_shared<TableSchema>();
+            schema->name = tableName;
+            schema->columns = {"id", getSingularForm(arrayNode->parentTable) + "_id", "seq"};
+            tables[tableName] = schema;
+            registerTable(tableName, schema);
+            objArrayMappings[arrayNode->parentTable].push_back(tableName);
+        }
 
         int index = 0;
         for (const auto& elem : arrayNode->elements) {
-            auto objNode = std::dynamic_pointer_cast<ObjectNode>(elem);
+            auto objNode = elem->asObject();
             objNode->parentTable = arrayNode->parentTable;
             objNode->parentKey = tableName;
             objNode->parentId = arrayNode->parentId;
             objNode->tableName = tableName;
             objNode->arrayIndex = index++;
-            analyzeObject(objNode);
+            analyzeObject(objNode, registerSchema);
+            if (!registerSchema) continue;
             auto& arraySchema = tables[tableName];
             for (const auto& pair : objNode->pairs) {
                 if (pair.value->getType() != NodeType::OBJECT && pair.value->getType() != NodeType::ARRAY) {
-                    std::string colName = trimString(pair.key);
+                    const std::string& colName = pair.key->trimmed;
                     if (std::find(arraySchema->columns.begin(), arraySchema->columns.end(), colName) == arraySchema->columns.end()) {
                         arraySchema->columns.push_back(colName);
                     }
@@ -505,118 +1347,322 @@ void CSVGenerator::analyzeArray(const std::shared_ptr<ArrayNode>& arrayNode, con
         }
     } else if (arrayNode->isArrayOfScalars()) {
         std::string tableName = trimString(parentKey);
-        auto schema = std::make_shared<TableSchema>();
-        schema->name = tableName;
-        schema->columns = {"id", getSingularForm(arrayNode->parentTable) + "_id", "seq", "value"};
-        tables[tableName] = schema;
-        scalarArrayMappings[arrayNode->parentTable].push_back(tableName);
+        if (registerSchema) {
+            auto schema = std::make_shared<TableSchema>();
+            schema->name = tableName;
+            schema->columns = {"id", getSingularForm(arrayNode->parentTable) + "_id", "seq", "value"};
+            tables[tableName] = schema;
+            registerTable(tableName, schema);
+            scalarArrayMappings[arrayNode->parentTable].push_back(tableName);
+        } else if (tableIds.find(tableName) == tableIds.end()) {
+            warnDroppedTable(tableName);
+        }
     }
 }
 
 
-void CSVGenerator::generateRowsFromAst(const std::shared_ptr<AstNode>& node) {
+void CSVGenerator::generateRowsFromAst(AstNode* node) {
     if (!node) return;
     
     // Process based on node type
     if (node->getType() == NodeType::OBJECT) {
-        auto objNode = std::dynamic_pointer_cast<ObjectNode>(node);
+        auto objNode = node->asObject();
         if (objNode) {
             generateRowsFromObject(objNode);
         }
     }
     else if (node->getType() == NodeType::ARRAY) {
-        auto arrayNode = std::dynamic_pointer_cast<ArrayNode>(node);
+        auto arrayNode = node->asArray();
         if (arrayNode) {
+            // First-pass row-count estimate: every element of an array of
+            // objects lands one row in the element table, so pre-size its
+            // flat buffer before either row pass starts appending
+            if (!streamingMode && spillBudget == 0 &&
+                arrayNode->isArrayOfObjects() && !arrayNode->elements.empty()) {
+                auto first = arrayNode->elements.front()->asObject();
+                if (first) {
+                    auto it = tables.find(first->tableName);
+                    if (it != tables.end()) {
+                        tablesById[static_cast<size_t>(mergeFind(it->second->id))]
+                            ->rows.reserveRows(arrayNode->elements.size());
+                    }
+                }
+            }
             generateRowsFromArray(arrayNode);
         }
     }
     // Other node types don't need processing
 }
 
-void CSVGenerator::generateRowsFromObject(const std::shared_ptr<ObjectNode>& objNode) {
-    if (!objNode || objNode->tableName.empty()) return;
+// Fan an array of objects out across the worker pool. The elements are
+// split into fixed-size chunk tasks that idle workers pull from a shared
+// queue, so wildly skewed element sizes (one order with 100k line-items
+// among thousands of small ones) no longer serialize everything behind
+// the big one the way static partitioning did. Each task walks its
+// elements into its own row buffer; buffers are merged in task order, so
+// output rows appear exactly as the sequential pass would emit them.
+void CSVGenerator::generateRowsFromArrayParallel(ArrayNode* arrayNode) {
+    size_t count = arrayNode->elements.size();
+    size_t taskCount = (count + PARALLEL_CHUNK_ELEMENTS - 1) / PARALLEL_CHUNK_ELEMENTS;
+    int workers = threadCount > 0 ? threadCount
+                                  : static_cast<int>(std::thread::hardware_concurrency());
+    if (static_cast<size_t>(workers) > taskCount) {
+        workers = static_cast<int>(taskCount);
+    }
 
-    std::string tableName = objNode->tableName;
-    auto tableIt = tables.find(tableName);
-    if (tableIt == tables.end()) return;
+    std::vector<LocalRows> taskRows(taskCount, LocalRows(tablesById.size()));
+    std::atomic<size_t> nextTask{0};
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
 
-    auto& schema = tableIt->second;
-    std::vector<std::string> row(schema->columns.size(), "");
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([this, arrayNode, count, &taskRows, &nextTask]() {
+            for (size_t t = nextTask.fetch_add(1); t < taskRows.size();
+                 t = nextTask.fetch_add(1)) {
+                size_t begin = t * PARALLEL_CHUNK_ELEMENTS;
+                size_t end = std::min(begin + PARALLEL_CHUNK_ELEMENTS, count);
+                for (size_t i = begin; i < end; ++i) {
+                    auto objNode = arrayNode->elements[i]->asObject();
+                    if (!objNode) continue;
+                    // Matches the index bookkeeping of the sequential loop
+                    // in generateRowsFromArray (which advances the counter
+                    // twice per element)
+                    objNode->arrayIndex = static_cast<int>(i * 2);
+                    objNode->parentId = arrayNode->parentId;
+                    generateRowsFromObject(objNode, &taskRows[t]);
+                }
+            }
+        });
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
 
-    auto idIt = std::find(schema->columns.begin(), schema->columns.end(), "id");
-    if (idIt != schema->columns.end()) {
-        int idIdx = std::distance(schema->columns.begin(), idIt);
-        row[idIdx] = std::to_string(objNode->id);
+    // Merge per-task buffers in task order
+    for (auto& local : taskRows) {
+        for (size_t id = 0; id < local.size(); ++id) {
+            auto& rows = local[id];
+            if (rows.empty()) continue;
+            auto& schema = tablesById[id];
+            auto& target = schema->rows;
+            target.reserveRows(rows.size());
+            for (const auto& row : rows) {
+                target.appendRow(row);
+            }
+            maybeSpillRows(*schema);
+        }
+    }
+}
+
+// Compile the table's slot program from a representative object. Called
+// lazily on the first row, once analysis and the relationship fixups have
+// frozen the column layout, so every index baked here stays valid for the
+// rest of the run.
+void CSVGenerator::compileRowEmitter(TableSchema& schema, const ObjectNode* objNode) {
+    schema.rowSlots.clear();
+    schema.rowSlots.reserve(objNode->pairs.size());
+    for (const auto& pair : objNode->pairs) {
+        RowSlot slot;
+        slot.key = pair.key;
+        slot.columnIndex = schema.columnIndexOf(pair.key->trimmed);
+        slot.type = pair.value->getType();
+        schema.rowSlots.push_back(slot);
+    }
+    schema.emitterIdIdx = schema.columnIndexOf("id");
+    schema.emitterSeqIdx = schema.columnIndexOf("seq");
+    schema.emitterParentTable = objNode->parentTable;
+    schema.emitterParentIdIdx = schema.columnIndexOf(getSingularForm(objNode->parentTable) + "_id");
+    schema.emitterReady.store(true, std::memory_order_release);
+}
+
+void CSVGenerator::generateRowsFromObject(ObjectNode* objNode, LocalRows* localRows) {
+    if (!objNode || objNode->tableId < 0) return;
+
+    // Merged tables redirect to their union-find representative
+    auto& schema = tablesById[static_cast<size_t>(mergeFind(objNode->tableId))];
+
+    // Excluded table: skip the row entirely, but keep walking — a kept
+    // child table may hang below this subtree
+    if (schema->excluded) {
+        for (const auto& pair : objNode->pairs) {
+            if (pair.value->getType() == NodeType::OBJECT) {
+                generateRowsFromObject(pair.value->asObject(), localRows);
+            } else if (pair.value->getType() == NodeType::ARRAY) {
+                generateRowsFromArray(pair.value->asArray(), localRows);
+            }
+        }
+        return;
+    }
+
+    // Compile the slot program on first contact with the table; the
+    // double-checked flag keeps the parallel workers off the mutex on the
+    // hot path once the program exists
+    if (!schema->emitterReady.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(emitterCompileMutex);
+        if (!schema->emitterReady.load(std::memory_order_relaxed)) {
+            compileRowEmitter(*schema, objNode);
+        }
+    }
+
+    RowScratch row(schema->columns.size());
+
+    int idIdx = schema->emitterIdIdx;
+    if (idIdx >= 0) {
+        row.setInt(idIdx, objNode->id);
     }
 
     if (objNode->parentId >= 0) {
-        std::string parentIdCol = getSingularForm(objNode->parentTable) + "_id";
-        auto parentIdIt = std::find(schema->columns.begin(), schema->columns.end(), parentIdCol);
-        if (parentIdIt != schema->columns.end()) {
-            int index = std::distance(schema->columns.begin(), parentIdIt);
-            row[index] = std::to_string(objNode->parentId);
+        int index;
+        if (objNode->parentTable == schema->emitterParentTable) {
+            index = schema->emitterParentIdIdx;
+        } else {
+            // Different parent than the one the emitter was compiled for:
+            // the parent schema carries its derived fk column, so even this
+            // path builds no strings
+            auto parentIt = tableIds.find(objNode->parentTable);
+            index = parentIt != tableIds.end()
+                        ? schema->columnIndexOf(tablesById[parentIt->second]->fkColumn)
+                        : schema->columnIndexOf(getSingularForm(objNode->parentTable) + "_id");
+        }
+        if (index >= 0) {
+            row.setInt(index, objNode->parentId);
         }
     }
 
     if (objNode->arrayIndex >= 0) {
-        auto seqIt = std::find(schema->columns.begin(), schema->columns.end(), "seq");
-        if (seqIt != schema->columns.end()) {
-            int seqIdx = std::distance(schema->columns.begin(), seqIt);
-            row[seqIdx] = std::to_string(objNode->arrayIndex);
+        int seqIdx = schema->emitterSeqIdx;
+        if (seqIdx >= 0) {
+            row.setInt(seqIdx, objNode->arrayIndex);
         }
     }
 
-    for (const auto& pair : objNode->pairs) {
-        std::string cleanKey = trimString(pair.key);
-        auto columnIt = std::find(schema->columns.begin(), schema->columns.end(), cleanKey);
-        if (columnIt != schema->columns.end() && pair.value->getType() != NodeType::OBJECT && pair.value->getType() != NodeType::ARRAY) {
-            int index = std::distance(schema->columns.begin(), columnIt);
-            std::string value;
-            if (pair.value->getType() == NodeType::STRING) {
-                value = quoteCSVField(std::dynamic_pointer_cast<StringNode>(pair.value)->value);
-            } else if (pair.value->getType() == NodeType::NUMBER) {
-                value = std::dynamic_pointer_cast<NumberNode>(pair.value)->toString();
-            } else if (pair.value->getType() == NodeType::BOOLEAN) {
-                value = std::dynamic_pointer_cast<BooleanNode>(pair.value)->toString();
+    // Objects whose interned key sequence matches the compiled program take
+    // the specialized path: direct indexed stores with the conversion baked
+    // in per slot, no string hashing. Keys are interned, so the validation
+    // is a handful of pointer compares.
+    const auto& slots = schema->rowSlots;
+    bool specialized = slots.size() == objNode->pairs.size();
+    if (specialized) {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (objNode->pairs[i].key != slots[i].key) {
+                specialized = false;
+                break;
+            }
+        }
+    }
+
+    if (specialized) {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            const RowSlot& slot = slots[i];
+            if (slot.columnIndex < 0) continue;
+            AstNode* value = objNode->pairs[i].value;
+            NodeType valueType = value->getType();
+            if (valueType == NodeType::OBJECT || valueType == NodeType::ARRAY) continue;
+            size_t dst = static_cast<size_t>(slot.columnIndex);
+            if (valueType == slot.type) {
+                switch (slot.type) {
+                    case NodeType::STRING:
+                        row.setText(dst, quoteCSVField(value->asString()->str()));
+                        break;
+                    case NodeType::NUMBER:
+                        // Numbers keep their source spelling; see CellKind
+                        row.setText(dst, value->asNumber()->toString());
+                        break;
+                    case NodeType::BOOLEAN:
+                        row.setBool(dst, value->asBoolean()->value);
+                        break;
+                    default:
+                        row.setText(dst, "");
+                        break;
+                }
             } else {
-                value = "";
+                // Type drifted from the compiled shape; convert generically
+                if (valueType == NodeType::STRING) {
+                    row.setText(dst, quoteCSVField(value->asString()->str()));
+                } else if (valueType == NodeType::NUMBER) {
+                    row.setText(dst, value->asNumber()->toString());
+                } else if (valueType == NodeType::BOOLEAN) {
+                    row.setBool(dst, value->asBoolean()->value);
+                } else {
+                    row.setText(dst, "");
+                }
+            }
+        }
+    } else {
+        for (const auto& pair : objNode->pairs) {
+            int index = schema->columnIndexOf(pair.key->trimmed);
+            if (index >= 0 && pair.value->getType() != NodeType::OBJECT && pair.value->getType() != NodeType::ARRAY) {
+                size_t dst = static_cast<size_t>(index);
+                if (pair.value->getType() == NodeType::STRING) {
+                    row.setText(dst, quoteCSVField(pair.value->asString()->str()));
+                } else if (pair.value->getType() == NodeType::NUMBER) {
+                    row.setText(dst, pair.value->asNumber()->toString());
+                } else if (pair.value->getType() == NodeType::BOOLEAN) {
+                    row.setBool(dst, pair.value->asBoolean()->value);
+                } else {
+                    row.setText(dst, "");
+                }
             }
-            row[index] = value;
         }
     }
 
     for (const auto& pair : objNode->pairs) {
         if (pair.value->getType() == NodeType::OBJECT) {
-            auto nestedObj = std::dynamic_pointer_cast<ObjectNode>(pair.value);
-            std::string fkCol = getSingularForm(nestedObj->tableName) + "_id";
-            auto fkIt = std::find(schema->columns.begin(), schema->columns.end(), fkCol);
-            if (fkIt != schema->columns.end()) {
-                int index = std::distance(schema->columns.begin(), fkIt);
-                row[index] = std::to_string(nestedObj->id);
-            }
-            generateRowsFromObject(nestedObj);
+            auto nestedObj = pair.value->asObject();
+            int index;
+            if (nestedObj->tableId >= 0) {
+                // Prefer the table's own fk column: when two same-shaped
+                // siblings merged, the parent keeps one column per child,
+                // and only a renamed fk resolves through the merge root
+                index = schema->columnIndexOf(
+                    tablesById[static_cast<size_t>(nestedObj->tableId)]->fkColumn);
+                if (index < 0) {
+                    index = schema->columnIndexOf(
+                        tablesById[static_cast<size_t>(mergeFind(nestedObj->tableId))]->fkColumn);
+                }
+            } else {
+                index = schema->columnIndexOf(getSingularForm(nestedObj->tableName) + "_id");
+            }
+            if (index >= 0) {
+                row.setInt(index, nestedObj->id);
+            }
+            generateRowsFromObject(nestedObj, localRows);
         } else if (pair.value->getType() == NodeType::ARRAY) {
-            generateRowsFromArray(std::dynamic_pointer_cast<ArrayNode>(pair.value));
+            generateRowsFromArray(pair.value->asArray(), localRows);
         }
     }
 
-    if (streamingMode) {
-        writeTableRow(schema->name, row);
+    if (localRows) {
+        (*localRows)[static_cast<size_t>(schema->id)].push_back(std::move(row));
+    } else if (streamingMode) {
+        writeTableRow(schema->id, row);
     } else {
-        schema->rows.push_back(row);
+        schema->rows.appendRow(row);
+        maybeSpillRows(*schema);
     }
 }
 
 
-void CSVGenerator::generateRowsFromArray(const std::shared_ptr<ArrayNode>& arrayNode) {
+void CSVGenerator::generateRowsFromArray(ArrayNode* arrayNode, LocalRows* localRows) {
     if (!arrayNode) return;
     
     if (arrayNode->isArrayOfObjects()) {
+        // Large arrays — top-level or nested — fan out across the worker
+        // pool unless this call is already inside a worker (localRows set)
+        // or rows must stream out in input order
+        int workers = threadCount > 0 ? threadCount
+                                      : static_cast<int>(std::thread::hardware_concurrency());
+        if (!localRows && !streamingMode && workers > 1 &&
+            arrayNode->elements.size() >= PARALLEL_MIN_ELEMENTS) {
+            generateRowsFromArrayParallel(arrayNode);
+            return;
+        }
+
         // For arrays of objects, process each object
         int index = 0;
         for (const auto& elem : arrayNode->elements) {
             if (elem->getType() == NodeType::OBJECT) {
-                auto objNode = std::dynamic_pointer_cast<ObjectNode>(elem);
+                auto objNode = elem->asObject();
                 if (objNode) {
                     // Set the array index for the sequence column
                     objNode->arrayIndex = index++;
@@ -625,95 +1671,98 @@ void CSVGenerator::generateRowsFromArray(const std::shared_ptr<ArrayNode>& array
                     objNode->parentId = arrayNode->parentId;
                     
                     // Process the object
-                    generateRowsFromObject(objNode);
+                    generateRowsFromObject(objNode, localRows);
                 }
             }
             index++;
         }
     } 
     else if (arrayNode->isArrayOfScalars()) {
-        // For arrays of scalars, create rows in the array table
-        std::string tableName = arrayNode->parentTable + "_" + arrayNode->parentKey;
-        
-        // Special cases for known scalar arrays
-        if (arrayNode->parentKey == "genres" || arrayNode->parentKey == "genre") {
-            tableName = "genre";
-        } else if (arrayNode->parentKey == "tags") {
-            tableName = "tags";
-        }
-        
-        // Find the table
-        auto tableIt = tables.find(tableName);
-        if (tableIt == tables.end()) {
-            // Look for table by name
-            for (const auto& [name, schema] : tables) {
-                if (schema->name == tableName) {
-                    tableName = name;
-                    break;
-                }
-            }
-            tableIt = tables.find(tableName);
-            if (tableIt == tables.end()) return;
-        }
-        
-        auto& schema = tableIt->second;
-        
-        // Find column positions
+        // For arrays of scalars, create rows in the array table. The table
+        // resolution and column positions were constant-folded into
+        // compileScalarArrayEmitters(); arrays the analysis pass never
+        // recorded (e.g. later NDJSON documents) re-derive them here.
+        TableSchema* schema = nullptr;
         int idIdx = -1, parentIdIdx = -1, seqIdx = -1, valueIdx = -1;
-        
-        // Find id column
-        auto idIt = std::find(schema->columns.begin(), schema->columns.end(), "id");
-        if (idIt != schema->columns.end()) {
-            idIdx = std::distance(schema->columns.begin(), idIt);
-        }
-        
-        // Find parent_id column or appropriate foreign key
-        std::string parentIdCol = getSingularForm(arrayNode->parentTable) + "_id";
-        auto parentIdIt = std::find(schema->columns.begin(), schema->columns.end(), parentIdCol);
-        if (parentIdIt != schema->columns.end()) {
-            parentIdIdx = std::distance(schema->columns.begin(), parentIdIt);
-        } else {
-            // Try parent_id
-            auto genericParentIdIt = std::find(schema->columns.begin(), schema->columns.end(), "parent_id");
-            if (genericParentIdIt != schema->columns.end()) {
-                parentIdIdx = std::distance(schema->columns.begin(), genericParentIdIt);
+
+        const ScalarArraySlots* slots = nullptr;
+        auto slotsParentIt = scalarArraySlots.find(arrayNode->parentTable);
+        if (slotsParentIt != scalarArraySlots.end()) {
+            auto slotsKeyIt = slotsParentIt->second.find(arrayNode->parentKey);
+            if (slotsKeyIt != slotsParentIt->second.end()) {
+                slots = &slotsKeyIt->second;
             }
         }
-        
-        // Find seq/index column
-        auto seqIt = std::find(schema->columns.begin(), schema->columns.end(), "seq");
-        if (seqIt != schema->columns.end()) {
-            seqIdx = std::distance(schema->columns.begin(), seqIt);
+
+        if (slots) {
+            if (slots->tableId < 0) return;
+            schema = tablesById[static_cast<size_t>(slots->tableId)].get();
+            idIdx = slots->idIdx;
+            parentIdIdx = slots->parentIdIdx;
+            seqIdx = slots->seqIdx;
+            valueIdx = slots->valueIdx;
         } else {
-            auto indexIt = std::find(schema->columns.begin(), schema->columns.end(), "index");
-            if (indexIt != schema->columns.end()) {
-                seqIdx = std::distance(schema->columns.begin(), indexIt);
+            std::string tableName = arrayNode->parentTable + "_" + arrayNode->parentKey;
+
+            // Special cases for known scalar arrays
+            if (arrayNode->parentKey == "genres" || arrayNode->parentKey == "genre") {
+                tableName = "genre";
+            } else if (arrayNode->parentKey == "tags") {
+                tableName = "tags";
             }
-        }
-        
-        // Find value column
-        auto valueIt = std::find(schema->columns.begin(), schema->columns.end(), "value");
-        if (valueIt != schema->columns.end()) {
-            valueIdx = std::distance(schema->columns.begin(), valueIt);
+
+            // Find the table
+            auto tableIt = tables.find(tableName);
+            if (tableIt == tables.end()) {
+                // Look for table by name
+                for (const auto& [name, candidate] : tables) {
+                    if (candidate->name == tableName) {
+                        tableName = name;
+                        break;
+                    }
+                }
+                tableIt = tables.find(tableName);
+                if (tableIt == tables.end()) return;
+            }
+
+            schema = tableIt->second.get();
+            if (schema->excluded) return;
+
+            // Find column positions
+            idIdx = schema->columnIndexOf("id");
+
+            // Parent foreign key, falling back to a generic parent_id column
+            parentIdIdx = schema->columnIndexOf(getSingularForm(arrayNode->parentTable) + "_id");
+            if (parentIdIdx < 0) {
+                parentIdIdx = schema->columnIndexOf("parent_id");
+            }
+
+            // Sequence column, falling back to an index column
+            seqIdx = schema->columnIndexOf("seq");
+            if (seqIdx < 0) {
+                seqIdx = schema->columnIndexOf("index");
+            }
+
+            valueIdx = schema->columnIndexOf("value");
         }
         
         // Create rows for each array element
         for (size_t i = 0; i < arrayNode->elements.size(); ++i) {
-            std::vector<std::string> row(schema->columns.size(), "");
+            RowScratch row(schema->columns.size());
             
             // Set ID (1-based)
             if (idIdx >= 0) {
-                row[idIdx] = std::to_string(i + 1);
+                row.setInt(idIdx, static_cast<long long>(i) + 1);
             }
             
             // Set parent ID
             if (parentIdIdx >= 0) {
-                row[parentIdIdx] = std::to_string(arrayNode->parentId);
+                row.setInt(parentIdIdx, arrayNode->parentId);
             }
             
             // Set sequence/index (0-based)
             if (seqIdx >= 0) {
-                row[seqIdx] = std::to_string(i);
+                row.setInt(seqIdx, static_cast<long long>(i));
             }
             
             // Set value
@@ -721,31 +1770,29 @@ void CSVGenerator::generateRowsFromArray(const std::shared_ptr<ArrayNode>& array
                 const auto& elem = arrayNode->elements[i];
                 
                 if (elem->getType() == NodeType::STRING) {
-                    auto strNode = std::dynamic_pointer_cast<StringNode>(elem);
-                    row[valueIdx] = trimString(unquote(strNode->toString()));
+                    auto strNode = elem->asString();
+                    row.setText(valueIdx, trimString(unquote(strNode->toString())));
                 }
                 else if (elem->getType() == NodeType::NUMBER) {
-                    auto numNode = std::dynamic_pointer_cast<NumberNode>(elem);
-                    row[valueIdx] = trimString(numNode->toString());
+                    auto numNode = elem->asNumber();
+                    row.setText(valueIdx, trimString(numNode->toString()));
                 }
                 else if (elem->getType() == NodeType::BOOLEAN) {
-                    auto boolNode = std::dynamic_pointer_cast<BooleanNode>(elem);
-                    row[valueIdx] = trimString(boolNode->toString());
+                    row.setBool(valueIdx, elem->asBoolean()->value);
                 }
                 else if (elem->getType() == NodeType::NULL_VALUE) {
-                    row[valueIdx] = "";
+                    row.setText(valueIdx, "");
                 }
             }
             
             // Add the row
-            if (streamingMode) {
-                std::vector<std::string> quotedRow;
-                for (const auto& val : row) {
-                    quotedRow.push_back(val);
-                }
-                writeTableRow(schema->name, quotedRow);
+            if (localRows) {
+                (*localRows)[static_cast<size_t>(schema->id)].push_back(std::move(row));
+            } else if (streamingMode) {
+                writeTableRow(schema->id, row);
             } else {
-                schema->rows.push_back(row);
+                schema->rows.appendRow(row);
+                maybeSpillRows(*schema);
             }
         }
     }
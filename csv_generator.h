@@ -8,78 +8,456 @@
 #include <memory>
 #include <sstream>
 #include <set>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
 #include "ast.h"
+#include "csv_writer.h"
 
 // Forward declarations
-struct ObjectShape;
 struct TableSchema;
 
+// Kind of value a row cell carries before the final write. Numbers keep
+// their source text (NumberNode preserves the input spelling exactly), so
+// native numeric cells only arise from values the generator mints itself:
+// row ids, foreign keys, and sequence indices.
+enum class CellKind : unsigned char { EMPTY, TEXT, INT64, BOOL };
+
+// One in-flight row with typed cells: integer and boolean values stay
+// native from emission to storage, so only genuinely-string fields pay
+// string costs. Unset cells render as empty.
+class RowScratch {
+public:
+    explicit RowScratch(size_t width)
+        : kinds(width, CellKind::EMPTY), ints(width, 0), texts(width) {}
+
+    void setInt(size_t i, long long v) { kinds[i] = CellKind::INT64; ints[i] = v; }
+    void setBool(size_t i, bool v) { kinds[i] = CellKind::BOOL; ints[i] = v ? 1 : 0; }
+    void setText(size_t i, std::string v) { kinds[i] = CellKind::TEXT; texts[i] = std::move(v); }
+
+    size_t width() const { return kinds.size(); }
+    CellKind kind(size_t i) const { return kinds[i]; }
+    long long intValue(size_t i) const { return ints[i]; }
+    const std::string& text(size_t i) const { return texts[i]; }
+
+    // Append the cell's textual form to `out` (empty cells add nothing)
+    void renderCell(size_t i, std::string& out) const;
+
+private:
+    std::vector<CellKind> kinds;
+    std::vector<long long> ints;
+    std::vector<std::string> texts;
+};
+
+// Typed columnar storage for a table's buffered rows. Each column commits
+// to the kind of the first non-empty cell it sees: int64 and bool columns
+// are packed native arrays (with a presence flag per row) that convert to
+// text only at the final write, while text columns share one contiguous
+// byte arena with an offset table. A column that later receives a
+// different kind is promoted to text in place, so type drift between rows
+// degrades gracefully instead of corrupting storage.
+class RowBuffer {
+public:
+    // Fix the column count; resets any stored rows. Must run before the
+    // first append (rebuildColumnIndex does this whenever columns change).
+    void setWidth(size_t columns);
+
+    // Pre-size native column storage from an estimated row count
+    // (first-pass estimate, e.g. the top-level array length)
+    void reserveRows(size_t rowCount, size_t avgCellBytes = 8);
+
+    // Append one completed row; its width must match the column count
+    void appendRow(const RowScratch& row);
+
+    size_t size() const { return rowCount; }
+
+    // Resident bytes held by the buffer (spill accounting)
+    size_t bytesUsed() const;
+
+    // Drop all buffered rows, keeping the column layout
+    void clear();
+
+    // Append row `row` to `line` in CSV form (cells joined by the field
+    // separator, newline-terminated)
+    void formatRow(size_t row, std::string& line) const;
+
+    // Read access to the committed column representations, used by the
+    // columnar backend to ship the storage as-is. Text offsets hold each
+    // cell's start; the end is the next offset (or the byte count for the
+    // last row). Native arrays are only populated for their kind.
+    CellKind columnKind(size_t c) const { return columns[c].kind; }
+    const std::string& textBytes(size_t c) const { return columns[c].bytes; }
+    const std::vector<size_t>& textOffsets(size_t c) const { return columns[c].offsets; }
+    const std::vector<long long>& nativeValues(size_t c) const { return columns[c].values; }
+    const std::vector<unsigned char>& presence(size_t c) const { return columns[c].present; }
+
+private:
+    struct Column {
+        CellKind kind = CellKind::EMPTY;  // committed on first non-empty cell
+
+        // Text storage (kind == TEXT): cell r spans [offsets[r], offsets[r+1])
+        std::string bytes;
+        std::vector<size_t> offsets;
+
+        // Native storage (kind == INT64 or BOOL)
+        std::vector<long long> values;
+        std::vector<unsigned char> present;
+
+        // Commit the column to `k`, backfilling `priorRows` empty cells
+        void commit(CellKind k, size_t priorRows, size_t reserveHint);
+
+        // Re-encode native values as text (type drift between rows)
+        void promoteToText();
+    };
+
+    std::vector<Column> columns;
+    size_t rowCount = 0;
+    size_t reserveHint = 0;
+    size_t reserveCellBytes = 0;
+};
+
+
 class CSVGenerator {
 private:
     std::string outputDir;
     bool streamingMode;
     
-    // Map to store table schemas
+    // Map to store table schemas (ordered: output files, stats, and the
+    // schema cache iterate it, so the ordering is part of the behaviour)
     std::map<std::string, std::shared_ptr<TableSchema>> tables;
+
+    // Dense integer table identity: every schema is also reachable through
+    // a small id assigned at registration, so the per-object and per-row
+    // paths index flat vectors instead of string-comparing their way
+    // through the ordered map
+    std::vector<std::shared_ptr<TableSchema>> tablesById;
+    std::unordered_map<std::string, int> tableIds;
+
+    // Open streaming writers indexed by table id (parallel to tableFiles)
+    std::vector<BufferedCSVWriter*> filesById;
+
+    // Register a schema under `key`, assigning its dense table id
+    int registerTable(const std::string& key, const std::shared_ptr<TableSchema>& schema);
     
-    // Map to track object types/shapes
-    std::map<std::string, std::shared_ptr<ObjectShape>> objectShapes;
-    
-    // Map for open file handles when in streaming mode
-    std::map<std::string, std::unique_ptr<std::ofstream>> tableFiles;
+    // Map of open buffered writers (streaming mode and lazy batch writes)
+    std::map<std::string, std::unique_ptr<BufferedCSVWriter>> tableFiles;
     
     // Set of tables that were merged into other tables
     std::set<std::string> mergedTables;
     
-    // Maps for tracking parent-child relationships
-    std::map<std::string, std::vector<std::string>> objArrayMappings;
-    std::map<std::string, std::vector<std::string>> scalarArrayMappings;
+    // Maps for tracking parent-child relationships (cold: only consulted
+    // while renaming tables)
+    std::unordered_map<std::string, std::vector<std::string>> objArrayMappings;
+    std::unordered_map<std::string, std::vector<std::string>> scalarArrayMappings;
     
+    // Output projection (--tables / --columns): tables to keep (empty =
+    // keep everything) and, per table, the columns to keep. Names match
+    // the output file names, i.e. the table registry keys.
+    std::set<std::string> tableFilter;
+    std::map<std::string, std::set<std::string>> columnFilter;
+
+    // Mark filtered-out tables as excluded and drop unlisted columns once
+    // the schemas are final; excluded tables emit no rows and no file
+    void applyProjection();
+
+    // Pre-resolved emitter state for one scalar-array table: the table and
+    // column positions the row pass would otherwise re-derive per array
+    // from name concatenations and lookups. tableId is -1 when resolution
+    // failed (or the table is excluded), meaning the array emits nothing.
+    struct ScalarArraySlots {
+        int tableId = -1;
+        int idIdx = -1;
+        int parentIdIdx = -1;
+        int seqIdx = -1;
+        int valueIdx = -1;
+    };
+
+    // (parent table, array key) -> resolved slots, built once the schemas
+    // are final; read-only during the row pass, so the workers share it
+    std::unordered_map<std::string,
+                       std::unordered_map<std::string, ScalarArraySlots>> scalarArraySlots;
+
+    // Resolve every scalar array recorded during analysis (constant-folds
+    // the per-array table lookup and derived column names away)
+    void compileScalarArrayEmitters();
+
+    // Path of the schema cache file ("" = caching disabled)
+    std::string schemaCachePath;
+
+    // Load resolved schemas from the cache file; returns false (leaving the
+    // generator untouched) when the file is missing or was built from an
+    // input with a different shape signature.
+    bool loadSchemaCache(const std::string& signature);
+
+    // Persist the resolved schemas and merge decisions for the next run
+    void saveSchemaCache(const std::string& signature) const;
+
+    // Incremental re-run state (--delta): per-record content hashes from
+    // the previous run, stored in a state file alongside the CSVs
+    bool deltaMode = false;
+
+    // Hashes of the current input's top-level records, in root-array order
+    std::vector<unsigned long long> recordHashes;
+
+    // Location of the delta state file (lives next to the output CSVs)
+    std::string deltaStatePath() const;
+
+    // Fill recordHashes from the root value (one hash per root-array
+    // element, or a single hash for a non-array root)
+    void computeRecordHashes(AstNode* root);
+
+    // True when the previous run's state matches recordHashes and all of
+    // its output files still exist, i.e. the CSVs can be reused as-is
+    bool deltaUnchanged() const;
+
+    // Persist recordHashes and the output file list for the next run
+    void saveDeltaState() const;
+
+    // Streaming input state (see consumeTopLevelValue)
+    bool streamInitialized = false;
+    bool streamSkippedWarned = false;
+
+    // Tables already reported by warnDroppedTable, so each one is
+    // diagnosed once per run rather than once per record
+    std::set<std::string> droppedTablesWarned;
+
+    // Report a table first seen after the streaming schema was fixed;
+    // its rows cannot be emitted (see consumeTopLevelValue)
+    void warnDroppedTable(const std::string& tableName);
+
+    // Next row id, stamped onto objects as the analyze walk first visits
+    // them (this replaced the separate AST::assignIds tree pass)
+    int nextRowId = 1;
+
     // Helper methods for analyzing the AST
-    void analyzeAst(const std::shared_ptr<AstNode>& node);
-    void analyzeObject(const std::shared_ptr<ObjectNode>& objNode);
-    void analyzeArray(const std::shared_ptr<ArrayNode>& arrayNode, const std::string& parentKey);
+    // When registerSchema is false the walk only annotates nodes with their
+    // parent/table links (used for records after the first in streaming mode,
+    // once the schemas and file headers are already fixed).
+    void analyzeAst(AstNode* node);
+    void analyzeObject(ObjectNode* objNode, bool registerSchema = true);
+    void analyzeArray(ArrayNode* arrayNode, const std::string& parentKey, bool registerSchema = true);
+
+    // Open per-table output files and write headers (streaming mode)
+    void setupStreamingOutput();
     
     // Table name and relationship management
     void renameTablesBasedOnContent();
     void processRelationships();
-    void mergeTable(const std::string& sourceTable, const std::string& targetTable);
+
+    // Shape-merge registry: a union-find structure over the dense table
+    // ids. Each table registers its shape signature the moment its columns
+    // are final (end of analysis in batch mode, first record in streaming
+    // mode); the second table with an equivalent shape unites into the
+    // first on the spot, and every row-emission site redirects through
+    // mergeFind() - so merges are settled before any row or header is
+    // written, which is what makes them streaming-safe.
+    std::vector<int> mergeParent;
+    std::unordered_map<std::string, int> shapeRegistry;
+
+    // Representative table id for `id` (the union-find root). Trees stay
+    // one or two hops deep - unions always link root to root - so there is
+    // no need for path compression and lookups stay const.
+    int mergeFind(int id) const;
+
+    // Redirect `sourceId` into `targetId`: rows emit into the target, the
+    // source is excluded from output, and foreign-key columns that named
+    // the source are renamed to name the target (one hashed lookup per
+    // table, not a column scan)
+    void mergeUnite(int sourceId, int targetId);
+
+    // Canonical merge signature of a table's shape: its sorted column
+    // names minus ids, foreign keys, and sequence columns. Empty means the
+    // table is too generic to merge on (e.g. scalar-array tables).
+    static std::string shapeSignature(const TableSchema& schema);
+
+    // Register every table's final shape, uniting equivalent ones
+    void unifyEquivalentShapes();
     
+    // Rows produced by one worker thread, keyed by table, merged into the
+    // per-table schemas once all workers finish
+    // (indexed by dense table id)
+    using LocalRows = std::vector<std::vector<RowScratch>>;
+
+    // Number of worker threads for batch row generation (0 = auto-detect)
+    int threadCount = 0;
+
+    // Per-table resident-row budget in bytes before buffered rows spill to
+    // a temp spool file (0 = spilling disabled)
+    size_t spillBudget = 0;
+
+    // Output compression applied by every table writer (--compress)
+    CSVCompression compression = CSVCompression::NONE;
+
+    // Output backend for the batch write phase (--format)
+    OutputFormat outputFormat = OutputFormat::CSV;
+
+    // Final path of a table's output file (adds .gz under compression)
+    std::string outputPath(const std::string& tableKey) const;
+
+    // Location of a table's spool file (lives next to the output CSVs)
+    std::string spoolPath(const std::string& tableKey) const;
+
+    // Spill the table's buffered rows to its spool file when they exceed
+    // the budget. Rows are already final text by the time they are
+    // buffered, so the spool holds pre-rendered row bytes that the write
+    // phase streams back out verbatim.
+    void maybeSpillRows(TableSchema& schema);
+
+    // Serializes the (rare) lazy compilation of row emitters when the
+    // parallel workers hit a table for the first time
+    std::mutex emitterCompileMutex;
+
+    // Compile a slot program for the table from a representative object
+    // (see the comment on TableSchema::rowSlots)
+    void compileRowEmitter(TableSchema& schema, const ObjectNode* objNode);
+
+    // Minimum array size before the parallel row pass kicks in, and the
+    // elements per task pulled from the shared queue
+    static constexpr size_t PARALLEL_MIN_ELEMENTS = 64;
+    static constexpr size_t PARALLEL_CHUNK_ELEMENTS = 64;
+
     // Helper methods for generating CSV rows
-    void generateRowsFromAst(const std::shared_ptr<AstNode>& node);
-    void generateRowsFromObject(const std::shared_ptr<ObjectNode>& objNode);
-    void generateRowsFromArray(const std::shared_ptr<ArrayNode>& arrayNode);
+    // When localRows is non-null, rows are collected there instead of being
+    // appended to the shared schemas (used by the parallel workers).
+    void generateRowsFromAst(AstNode* node);
+    void generateRowsFromObject(ObjectNode* objNode, LocalRows* localRows = nullptr);
+    void generateRowsFromArray(ArrayNode* arrayNode, LocalRows* localRows = nullptr);
+
+    // Split an array of objects into chunk tasks dynamically pulled by a
+    // worker pool, merging per-task row buffers back into the schemas in
+    // element order. Called for any sufficiently large array — top-level
+    // or nested — that is not already running inside a worker.
+    void generateRowsFromArrayParallel(ArrayNode* arrayNode);
     
     // Helper methods for CSV output
     std::string quoteCSVField(const std::string& field);
-    void writeTableRow(const std::string& tableName, const std::vector<std::string>& row);
-    
-    // Helpers for determining table names
-    std::string getTableNameForObjectShape(const std::string& signature);
-    std::string getTableNameForArray(const std::string& parentTable, const std::string& key);
+    void writeTableRow(int tableId, const RowScratch& row);
     
+
 public:
     CSVGenerator(std::string outputDir = "", bool streaming = false);
     ~CSVGenerator();
     
     // Generate CSV files from AST
     void generateCSV(const AST& ast);
+
+    // Streaming input mode: consume one completed top-level array element,
+    // emitting its rows immediately. The caller frees the subtree afterwards,
+    // so peak memory is bounded by the largest single record. The first
+    // record fixes the schemas and file headers; columns — and whole
+    // tables — that only appear in later records are dropped, with a
+    // per-table warning for the latter (see warnDroppedTable).
+    void consumeTopLevelValue(AstNode* node);
+
+    // NDJSON / concatenated-document mode: consume one complete top-level
+    // document. Object documents emit their rows directly; array documents
+    // emit each object element, so a stream of arrays behaves like one long
+    // array. Schemas and open table files accumulate across documents — the
+    // first document fixes them, exactly like the first record in --stream
+    // mode — and the caller frees each document's AST afterwards.
+    void consumeDocument(AstNode* node);
+
+    // Flush and close the output files opened by streaming mode
+    void finishStreaming();
+
+    // Set the worker count for the parallel batch row pass (0 = auto)
+    void setThreadCount(int count) { threadCount = count; }
+
+    // Bound batch-mode resident memory: tables whose buffered rows exceed
+    // `bytes` spill them to a temp spool file and stream them back during
+    // the final write phase (0 = keep everything resident)
+    void setSpillBudget(size_t bytes) { spillBudget = bytes; }
+
+    // Enable incremental re-runs: record per-record content hashes next to
+    // the CSVs, and when the whole record range is unchanged from the
+    // previous run, skip generation and keep the existing files. Any change
+    // falls back to a full regeneration (row ids shift with the input).
+    void setDeltaMode(bool on) { deltaMode = on; }
+
+    // Compress every output file as it is written (--compress)
+    void setCompression(CSVCompression mode) { compression = mode; }
+
+    // Select the batch output backend (--format); columnar writes each
+    // table as the binary format described in columnar_writer.h
+    void setOutputFormat(OutputFormat fmt) { outputFormat = fmt; }
+
+    // Restrict output to the named tables (--tables); names match the
+    // output file names
+    void setTableFilter(std::set<std::string> names) { tableFilter = std::move(names); }
+
+    // Restrict the named tables to the listed columns (--columns)
+    void setColumnFilter(std::map<std::string, std::set<std::string>> cols) {
+        columnFilter = std::move(cols);
+    }
+
+    // Enable the schema cache: when the file exists and matches the input's
+    // shape signature, the analysis pass is skipped entirely; otherwise the
+    // resolved schemas are written there after analysis.
+    void setSchemaCachePath(const std::string& path) { schemaCachePath = path; }
     
     // Get all table names
     std::vector<std::string> getTableNames() const;
 };
 
-// Structure to represent an object's shape (field names and types)
-struct ObjectShape {
-    std::string tableName;
-    std::map<std::string, NodeType> fields;
+// One pair position in a compiled row program: the destination column and
+// the value conversion observed when the program was compiled
+struct RowSlot {
+    const InternedString* key = nullptr;
+    int columnIndex = -1;
+    NodeType type = NodeType::NULL_VALUE;
 };
 
 // Structure to represent a table schema
 struct TableSchema {
     std::string name;
+
+    // Registry key the table was created under, and its dense id
+    // (see CSVGenerator::registerTable)
+    std::string key;
+    int id = -1;
+
+    // Rows emitted through the streaming path, folded into the run stats
+    // when the stream finishes
+    unsigned long long emittedRows = 0;
+
+    // Filtered out by --tables: no rows are generated and no file written
+    bool excluded = false;
     std::vector<std::string> columns;
-    std::vector<std::vector<std::string>> rows;
+    RowBuffer rows;
+
+    // Column name -> position in columns, built once the schema is final so
+    // the row pass does direct indexed stores instead of linear scans.
+    // Duplicate column names map to their first occurrence, matching the
+    // std::find behaviour this replaces.
+    std::unordered_map<std::string, int> columnIndex;
+
+    // Rebuild columnIndex from columns (call after any column mutation)
+    void rebuildColumnIndex();
+
+    // Position of a column, or -1 if the table has no such column
+    int columnIndexOf(const std::string& column) const;
+
+    // Compiled row program, built lazily from the first object emitted into
+    // this table once the columns are final. The field -> column mapping is
+    // constant per object shape, so the row pass validates an object's
+    // interned key sequence against the program with pointer compares and,
+    // on a match, fills the row as a tight indexed loop with no per-field
+    // string hashing; mismatching objects fall back to the generic lookups.
+    std::vector<RowSlot> rowSlots;
+    int emitterIdIdx = -1;
+    int emitterSeqIdx = -1;
+    int emitterParentIdIdx = -1;
+    std::string emitterParentTable;
+    std::atomic<bool> emitterReady{false};
+
+    // Foreign-key column other tables use to point at this one, derived
+    // once from the registry key (getSingularForm(key) + "_id") so the row
+    // pass never rebuilds it per row
+    std::string fkColumn;
+
+    // External spill state (batch mode): rows already serialized to the
+    // spool file ahead of whatever is still resident in `rows`
+    size_t spilledRows = 0;
 };
 
 #endif // CSV_GENERATOR_H
\ No newline at end of file
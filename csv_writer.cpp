@@ -0,0 +1,155 @@
+#include "csv_writer.h"
+
+#include <cstring>
+#include <iostream>
+
+BufferedCSVWriter::BufferedCSVWriter(const std::string& filename, size_t bufferSize,
+                                     bool async, CSVCompression compress)
+    : out(filename, std::ios::binary), bufferLimit(bufferSize),
+      compression(compress), asyncMode(async) {
+    buffer.reserve(bufferSize);
+
+    if (compression == CSVCompression::GZIP) {
+        std::memset(&zstream, 0, sizeof(zstream));
+        // windowBits 15 + 16 selects the gzip wrapper
+        if (deflateInit2(&zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK) {
+            zstreamInit = true;
+            zbuffer.resize(bufferSize);
+        } else {
+            std::cerr << "Error: could not initialize gzip compression for "
+                      << filename << ", writing uncompressed" << std::endl;
+            compression = CSVCompression::NONE;
+        }
+    }
+}
+
+BufferedCSVWriter::~BufferedCSVWriter() {
+    close();
+}
+
+void BufferedCSVWriter::writeRow(const std::vector<std::string>& row) {
+    if (row.empty()) return;
+
+    buffer += row[0];
+    for (size_t i = 1; i < row.size(); ++i) {
+        buffer += " , ";
+        buffer += row[i];
+    }
+    buffer += '\n';
+    totalBytes += row[0].size() + 1;
+    for (size_t i = 1; i < row.size(); ++i) {
+        totalBytes += row[i].size() + 3;
+    }
+
+    if (buffer.size() >= bufferLimit) {
+        flush();
+    }
+}
+
+void BufferedCSVWriter::writeRaw(const char* data, size_t length) {
+    buffer.append(data, length);
+    totalBytes += length;
+    if (buffer.size() >= bufferLimit) {
+        flush();
+    }
+}
+
+void BufferedCSVWriter::flush() {
+    if (buffer.empty() || !out.is_open()) return;
+
+    if (asyncMode) {
+        flushAsync();
+        return;
+    }
+
+    writeChunk(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+void BufferedCSVWriter::writeChunk(const char* data, size_t length) {
+    if (compression == CSVCompression::NONE) {
+        out.write(data, static_cast<std::streamsize>(length));
+        return;
+    }
+
+    zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zstream.avail_in = static_cast<uInt>(length);
+    while (zstream.avail_in > 0) {
+        zstream.next_out = zbuffer.data();
+        zstream.avail_out = static_cast<uInt>(zbuffer.size());
+        deflate(&zstream, Z_NO_FLUSH);
+        size_t produced = zbuffer.size() - zstream.avail_out;
+        if (produced > 0) {
+            out.write(reinterpret_cast<const char*>(zbuffer.data()),
+                      static_cast<std::streamsize>(produced));
+        }
+    }
+}
+
+// Hand the full buffer to the I/O thread and take back the drained one.
+// Generation only blocks here when it produces faster than the disk
+// drains — exactly the case where there is nothing better to do.
+void BufferedCSVWriter::flushAsync() {
+    std::unique_lock<std::mutex> lock(ioMutex);
+    if (!ioThread.joinable()) {
+        flushBuffer.reserve(bufferLimit);
+        ioThread = std::thread(&BufferedCSVWriter::ioLoop, this);
+    }
+    ioCv.wait(lock, [this]() { return !flushPending; });
+    buffer.swap(flushBuffer);
+    flushPending = true;
+    ioCv.notify_all();
+}
+
+void BufferedCSVWriter::ioLoop() {
+    std::unique_lock<std::mutex> lock(ioMutex);
+    for (;;) {
+        ioCv.wait(lock, [this]() { return flushPending || shuttingDown; });
+        if (flushPending) {
+            // Write without the lock so the generator can keep appending
+            lock.unlock();
+            writeChunk(flushBuffer.data(), flushBuffer.size());
+            flushBuffer.clear();
+            lock.lock();
+            flushPending = false;
+            ioCv.notify_all();
+        } else if (shuttingDown) {
+            return;
+        }
+    }
+}
+
+void BufferedCSVWriter::close() {
+    if (!out.is_open()) return;
+
+    flush();
+    if (ioThread.joinable()) {
+        {
+            std::unique_lock<std::mutex> lock(ioMutex);
+            ioCv.wait(lock, [this]() { return !flushPending; });
+            shuttingDown = true;
+        }
+        ioCv.notify_all();
+        ioThread.join();
+    }
+    if (zstreamInit) {
+        // Drain the deflate context and emit the gzip trailer
+        zstream.next_in = nullptr;
+        zstream.avail_in = 0;
+        int rc;
+        do {
+            zstream.next_out = zbuffer.data();
+            zstream.avail_out = static_cast<uInt>(zbuffer.size());
+            rc = deflate(&zstream, Z_FINISH);
+            size_t produced = zbuffer.size() - zstream.avail_out;
+            if (produced > 0) {
+                out.write(reinterpret_cast<const char*>(zbuffer.data()),
+                          static_cast<std::streamsize>(produced));
+            }
+        } while (rc != Z_STREAM_END);
+        deflateEnd(&zstream);
+        zstreamInit = false;
+    }
+    out.close();
+}
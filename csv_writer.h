@@ -0,0 +1,107 @@
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+// Output compression applied by BufferedCSVWriter as buffers are flushed
+// (--compress). Each writer owns an independent deflate context, so the
+// per-table writer threads compress in parallel. zstd would slot in here
+// as another enumerator once libzstd is part of the build.
+enum class CSVCompression {
+    NONE,
+    GZIP,
+};
+
+// Output backend the batch write phase hands finished tables to
+// (--format): row-oriented CSV text, or the footer-indexed columnar
+// binary format described in columnar_writer.h.
+enum class OutputFormat {
+    CSV,
+    COLUMNAR,
+};
+
+// Buffered CSV file writer.
+//
+// Rows are assembled into a large in-memory buffer and written with few
+// big write() calls, instead of one ofstream operator<< per field and a
+// flush per line via std::endl. On multi-million-row outputs this keeps
+// the tool from becoming syscall-bound.
+//
+// With async enabled the writer double-buffers: flush() swaps the full
+// append buffer with a second one and hands it to a dedicated I/O thread,
+// so row generation keeps filling one buffer while the previous one is on
+// its way to disk. Disk time then hides behind compute time instead of
+// adding to it. The thread is started lazily on the first flush, so tiny
+// outputs that fit in one buffer never pay for it.
+class BufferedCSVWriter {
+public:
+    // 1 MB append buffer per table by default
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    explicit BufferedCSVWriter(const std::string& filename,
+                               size_t bufferSize = DEFAULT_BUFFER_SIZE,
+                               bool async = false,
+                               CSVCompression compression = CSVCompression::NONE);
+    ~BufferedCSVWriter();
+
+    // Whether the underlying file opened successfully
+    bool isOpen() const { return out.is_open(); }
+
+    // Append one row, joining fields with the CSV field separator
+    void writeRow(const std::vector<std::string>& row);
+
+    // Append raw pre-formatted bytes (must include any trailing newline)
+    void writeRaw(const char* data, size_t length);
+
+    // Flush the append buffer to the file (hands it to the I/O thread in
+    // async mode; blocks only if the previous buffer is still in flight)
+    void flush();
+
+    // Flush and close the file; joins the I/O thread in async mode
+    void close();
+
+    // Total bytes appended so far (including any not yet flushed); counts
+    // the CSV bytes handed to the writer, before any compression
+    size_t bytesWritten() const { return totalBytes; }
+
+private:
+    void flushAsync();
+    void ioLoop();
+
+    // Write one drained buffer to the file, deflating it first when
+    // compression is on. Only ever called from one thread at a time: the
+    // flushing thread in sync mode, the I/O thread in async mode, and the
+    // closing thread after the I/O thread has been joined.
+    void writeChunk(const char* data, size_t length);
+
+    std::ofstream out;
+    std::string buffer;
+    size_t bufferLimit;
+    size_t totalBytes = 0;
+
+    // Compression state; zstreamInit marks a live deflate context that
+    // close() must finish and tear down
+    CSVCompression compression = CSVCompression::NONE;
+    z_stream zstream;
+    bool zstreamInit = false;
+    std::vector<unsigned char> zbuffer;
+
+    // Double-buffering state; untouched (and the thread never started)
+    // unless async was requested
+    bool asyncMode = false;
+    std::thread ioThread;
+    std::mutex ioMutex;
+    std::condition_variable ioCv;
+    std::string flushBuffer;   // buffer currently owned by the I/O thread
+    bool flushPending = false; // flushBuffer holds bytes not yet written
+    bool shuttingDown = false;
+};
+
+#endif // CSV_WRITER_H
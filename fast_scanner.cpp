@@ -0,0 +1,331 @@
+#include "fast_scanner.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ast.h"
+#include "stats.h"
+#include "strkernels.h"
+#include "parser.tab.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Flex scanner state shared with the fallback path
+extern int yylex();
+extern int lineno;
+extern int column;
+
+namespace {
+
+// Raw token from the structural pass: a kind plus a byte range into the
+// input buffer. STRING ranges cover the body without the quotes.
+struct RawToken {
+    int kind;
+    uint32_t start;
+    uint32_t length;
+    int line;      // line the token starts on
+    int colAfter;  // column just past the token, flex-style
+};
+
+// Materialized token ready for the parser. STRING tokens stay as raw
+// slices - the lazy StringNode decodes them on first use, so only values
+// that actually reach the output pay for unescaping.
+struct Token {
+    int kind;
+    std::string* text = nullptr;  // owned NUMBER spelling
+    const char* raw = nullptr;    // STRING body slice into the input
+    uint32_t rawLength = 0;
+    bool boolValue = false;
+    int line;
+    int colAfter;
+};
+
+const char* scanData = nullptr;
+std::vector<RawToken> rawTokens;
+std::vector<Token> tokens;
+size_t cursor = 0;
+bool active = false;
+
+// Find the next '"' or '\\' in a string body, 16 bytes per step
+size_t findStringSpecial(const char* data, size_t from, size_t end) {
+    size_t i = from;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    for (; i + 16 <= end; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                  _mm_cmpeq_epi8(chunk, slash)));
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#else
+    const uint64_t quote = 0x0101010101010101ULL * static_cast<unsigned char>('"');
+    const uint64_t slash = 0x0101010101010101ULL * static_cast<unsigned char>('\\');
+    for (; i + 8 <= end; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        uint64_t xq = word ^ quote;
+        uint64_t xs = word ^ slash;
+        uint64_t hit = (((xq - 0x0101010101010101ULL) & ~xq) |
+                        ((xs - 0x0101010101010101ULL) & ~xs)) & 0x8080808080808080ULL;
+        if (hit != 0) {
+            return i + static_cast<size_t>(__builtin_ctzll(hit)) / 8;
+        }
+    }
+#endif
+
+    for (; i < end; ++i) {
+        if (data[i] == '"' || data[i] == '\\') return i;
+    }
+    return end;
+}
+
+// Structural pass: one sequential walk that finds every token boundary.
+// String bodies — where almost all the bytes are — advance through the
+// vectorized kernel above instead of byte by byte.
+void structuralPass(const char* data, size_t size) {
+    size_t i = 0;
+    int line = 1;
+    int col = 1;
+
+    auto push = [&](int kind, size_t start, size_t end, int tokLine) {
+        RawToken tok;
+        tok.kind = kind;
+        tok.start = static_cast<uint32_t>(start);
+        tok.length = static_cast<uint32_t>(end - start);
+        tok.line = tokLine;
+        tok.colAfter = col;
+        rawTokens.push_back(tok);
+    };
+
+    while (i < size) {
+        char c = data[i];
+
+        if (c == ' ' || c == '\t' || c == '\r') {
+            ++i;
+            ++col;
+            continue;
+        }
+        if (c == '\n') {
+            ++i;
+            ++line;
+            col = 1;
+            continue;
+        }
+
+        if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') {
+            ++i;
+            ++col;
+            push(c, i - 1, i, line);
+            continue;
+        }
+
+        if (c == '"') {
+            size_t bodyStart = i + 1;
+            size_t p = bodyStart;
+            int tokLine = line;
+            while (p < size) {
+                p = findStringSpecial(data, p, size);
+                if (p >= size) break;
+                if (data[p] == '"') break;
+                p += 2; // skip the backslash and the escaped character
+            }
+            if (p >= size) {
+                // Unterminated string; flex would report the quote itself
+                fprintf(stderr, "Error: Unexpected character '%c' at line %d, column %d\n",
+                        c, line, col);
+                push(ERROR, i, i + 1, line);
+                ++i;
+                ++col;
+                continue;
+            }
+            // Track embedded newlines the way the flex pattern allows them
+            for (size_t q = i; q <= p; ++q) {
+                if (data[q] == '\n') {
+                    ++line;
+                    col = 0;
+                }
+                ++col;
+            }
+            push(STRING, bodyStart, p, tokLine);
+            i = p + 1;
+            continue;
+        }
+
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            size_t start = i;
+            int tokLine = line;
+            if (c == '-') ++i;
+            while (i < size && data[i] >= '0' && data[i] <= '9') ++i;
+            if (i < size && data[i] == '.' && i + 1 < size &&
+                data[i + 1] >= '0' && data[i + 1] <= '9') {
+                ++i;
+                while (i < size && data[i] >= '0' && data[i] <= '9') ++i;
+            }
+            if (i < size && (data[i] == 'e' || data[i] == 'E')) {
+                size_t e = i + 1;
+                if (e < size && (data[e] == '+' || data[e] == '-')) ++e;
+                if (e < size && data[e] >= '0' && data[e] <= '9') {
+                    i = e;
+                    while (i < size && data[i] >= '0' && data[i] <= '9') ++i;
+                }
+            }
+            if (i == start) {
+                // Bare '-' with no digits
+                ++i;
+                ++col;
+                fprintf(stderr, "Error: Unexpected character '%c' at line %d, column %d\n",
+                        c, tokLine, col - 1);
+                push(ERROR, start, i, tokLine);
+                continue;
+            }
+            col += static_cast<int>(i - start);
+            push(NUMBER, start, i, tokLine);
+            continue;
+        }
+
+        if (size - i >= 4 && std::memcmp(data + i, "true", 4) == 0) {
+            i += 4;
+            col += 4;
+            push(TRUE, i - 4, i, line);
+            continue;
+        }
+        if (size - i >= 5 && std::memcmp(data + i, "false", 5) == 0) {
+            i += 5;
+            col += 5;
+            push(FALSE, i - 5, i, line);
+            continue;
+        }
+        if (size - i >= 4 && std::memcmp(data + i, "null", 4) == 0) {
+            i += 4;
+            col += 4;
+            push(NUL, i - 4, i, line);
+            continue;
+        }
+
+        fprintf(stderr, "Error: Unexpected character '%c' at line %d, column %d\n",
+                c, line, col);
+        ++i;
+        ++col;
+        push(ERROR, i - 1, i, line);
+    }
+}
+
+// Workers pull fixed-size chunks of raw tokens and materialize them in
+// parallel; with strings handed over lazily this now only covers the
+// NUMBER spellings, but those still allocate one std::string each
+constexpr size_t MATERIALIZE_CHUNK = 4096;
+
+void materializeRange(size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) {
+        const RawToken& raw = rawTokens[t];
+        Token& tok = tokens[t];
+        tok.kind = raw.kind;
+        tok.line = raw.line;
+        tok.colAfter = raw.colAfter;
+        const char* start = scanData + raw.start;
+        switch (raw.kind) {
+            case STRING:
+                tok.raw = start;
+                tok.rawLength = raw.length;
+                break;
+            case NUMBER:
+                tok.text = new std::string(start, raw.length);
+                break;
+            case TRUE:
+                tok.boolValue = true;
+                break;
+            case FALSE:
+                tok.boolValue = false;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void materializeTokens(int threads) {
+    tokens.resize(rawTokens.size());
+
+    int workers = threads > 0 ? threads
+                              : static_cast<int>(std::thread::hardware_concurrency());
+    size_t chunkCount = (rawTokens.size() + MATERIALIZE_CHUNK - 1) / MATERIALIZE_CHUNK;
+    if (static_cast<size_t>(workers) > chunkCount) {
+        workers = static_cast<int>(chunkCount);
+    }
+
+    if (workers <= 1) {
+        materializeRange(0, rawTokens.size());
+        return;
+    }
+
+    std::atomic<size_t> nextChunk{0};
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&nextChunk]() {
+            for (size_t chunk = nextChunk.fetch_add(1);
+                 chunk * MATERIALIZE_CHUNK < rawTokens.size();
+                 chunk = nextChunk.fetch_add(1)) {
+                size_t begin = chunk * MATERIALIZE_CHUNK;
+                size_t end = std::min(begin + MATERIALIZE_CHUNK, rawTokens.size());
+                materializeRange(begin, end);
+            }
+        });
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+}
+
+} // namespace
+
+void fastScanBuffer(const char* data, size_t size, int threads) {
+    scanData = data;
+    structuralPass(data, size);
+    materializeTokens(threads);
+    runStats().tokens += static_cast<unsigned long long>(rawTokens.size());
+    cursor = 0;
+    active = true;
+}
+
+int json2relcsv_lex() {
+    if (!active) {
+        return yylex();
+    }
+    if (cursor >= tokens.size()) {
+        return 0;
+    }
+
+    Token& tok = tokens[cursor++];
+    lineno = tok.line;
+    column = tok.colAfter;
+    switch (tok.kind) {
+        case STRING:
+            yylval.lexstr_val.text = nullptr;
+            yylval.lexstr_val.raw = tok.raw;
+            yylval.lexstr_val.raw_len = tok.rawLength;
+            break;
+        case NUMBER:
+            yylval.string_val = tok.text;
+            break;
+        case TRUE:
+        case FALSE:
+            yylval.bool_val = tok.boolValue;
+            break;
+        default:
+            break;
+    }
+    return tok.kind;
+}
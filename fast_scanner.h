@@ -0,0 +1,30 @@
+#ifndef FAST_SCANNER_H
+#define FAST_SCANNER_H
+
+#include <cstddef>
+
+// Flex-free lexer front-end (--fast-scan).
+//
+// The flex scanner is a serial byte-at-a-time DFA; once row generation went
+// parallel it became the bottleneck. This front-end tokenizes the whole
+// in-memory input before the parse: a single structural pass finds token
+// boundaries (string bodies are skipped 16 bytes per step with the same
+// SSE2/SWAR kernels strkernels uses), then worker threads materialize the
+// number tokens in parallel chunks; string tokens are handed to the parser
+// as raw slices that the lazy StringNode decodes only on first use. The
+// parser then drains the finished token stream through json2relcsv_lex(),
+// which falls back to the flex yylex() whenever fast-scan is not active, so
+// the flex path stays available for correctness comparison.
+//
+// Requires the full input in memory (the mmap path of --input, or a slurped
+// copy); tokens for malformed bytes come out as ERROR, matching flex.
+
+// Tokenize `data`/`size` and activate the fast path for this process.
+// `threads` follows the --threads convention (0 = auto-detect).
+void fastScanBuffer(const char* data, size_t size, int threads);
+
+// Lexer entry point the parser is bound to (see parser.y); dispatches to
+// the pre-scanned token stream or the flex scanner.
+int json2relcsv_lex();
+
+#endif // FAST_SCANNER_H
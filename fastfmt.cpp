@@ -0,0 +1,52 @@
+#include "fastfmt.h"
+
+#include <cstring>
+
+namespace fastfmt {
+
+namespace {
+
+// All two-digit pairs 00..99, so the main loop emits two digits per step
+const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+} // namespace
+
+size_t formatInt(long long value, char* buf) {
+    char tmp[MAX_INT_CHARS];
+    char* p = tmp + sizeof(tmp);
+
+    bool negative = value < 0;
+    // Work on the unsigned magnitude so LLONG_MIN doesn't overflow
+    unsigned long long v = negative
+        ? ~static_cast<unsigned long long>(value) + 1
+        : static_cast<unsigned long long>(value);
+
+    while (v >= 100) {
+        unsigned long long q = v / 100;
+        unsigned rem = static_cast<unsigned>(v - q * 100);
+        p -= 2;
+        p[0] = kDigitPairs[rem * 2];
+        p[1] = kDigitPairs[rem * 2 + 1];
+        v = q;
+    }
+    if (v >= 10) {
+        p -= 2;
+        p[0] = kDigitPairs[v * 2];
+        p[1] = kDigitPairs[v * 2 + 1];
+    } else {
+        *--p = static_cast<char>('0' + v);
+    }
+    if (negative) {
+        *--p = '-';
+    }
+
+    size_t len = static_cast<size_t>(tmp + sizeof(tmp) - p);
+    std::memcpy(buf, p, len);
+    return len;
+}
+
+} // namespace fastfmt
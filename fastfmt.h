@@ -0,0 +1,37 @@
+#ifndef FASTFMT_H
+#define FASTFMT_H
+
+#include <string>
+#include <cstddef>
+
+// Branch-light numeric formatting kernels for the row emission paths.
+//
+// std::to_string routes through locale-aware snprintf machinery; at tens of
+// millions of rows the id/parent/seq conversions alone cost seconds of wall
+// time. formatInt writes digits with a two-digits-per-step lookup table and
+// the assign helper places them straight into a row cell with no
+// intermediate std::string.
+namespace fastfmt {
+
+// Maximum characters (sign plus digits) a 64-bit value can produce
+constexpr size_t MAX_INT_CHARS = 20;
+
+// Write `value` as decimal ASCII into `buf` (no terminator); returns the
+// number of characters written. `buf` must hold MAX_INT_CHARS bytes.
+size_t formatInt(long long value, char* buf);
+
+// Replace `out` with the decimal form of `value`
+inline void assignInt(std::string& out, long long value) {
+    char buf[MAX_INT_CHARS];
+    out.assign(buf, formatInt(value, buf));
+}
+
+// Append the decimal form of `value` to `out`
+inline void appendInt(std::string& out, long long value) {
+    char buf[MAX_INT_CHARS];
+    out.append(buf, formatInt(value, buf));
+}
+
+} // namespace fastfmt
+
+#endif // FASTFMT_H
@@ -0,0 +1,17 @@
+#include "intern.h"
+
+// Defined in csv_generator.cpp
+extern std::string trimString(const std::string& str);
+
+const InternedString* StringInterner::intern(const std::string& key) {
+    auto it = pool.find(key);
+    if (it == pool.end()) {
+        it = pool.emplace(key, InternedString{key, trimString(key)}).first;
+    }
+    return &it->second;
+}
+
+StringInterner& keyInterner() {
+    static StringInterner interner;
+    return interner;
+}
@@ -0,0 +1,35 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <string>
+#include <unordered_map>
+
+// One interned key string.
+//
+// Identical JSON keys share a single InternedString, so comparing keys is
+// pointer equality and the whitespace-trimmed form used for column matching
+// is computed exactly once instead of per row.
+struct InternedString {
+    std::string text;     // Key as it appeared in the input
+    std::string trimmed;  // Whitespace-trimmed form used for column names
+};
+
+// Interning table for JSON object keys.
+//
+// The parser funnels every key through intern(), so an array of millions of
+// objects with the same keys stores each distinct key once. Returned
+// pointers stay valid for the interner's lifetime.
+class StringInterner {
+public:
+    const InternedString* intern(const std::string& key);
+
+    size_t size() const { return pool.size(); }
+
+private:
+    std::unordered_map<std::string, InternedString> pool;
+};
+
+// Process-wide interner used by the parser for object keys
+StringInterner& keyInterner();
+
+#endif // INTERN_H
@@ -4,30 +4,189 @@
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+#include <cstdlib>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "ast.h"
 #include "csv_generator.h"
+#include "fast_scanner.h"
+#include "intern.h"
+#include "stats.h"
 
 // External declarations from parser
 extern AST ast;
 extern int yyparse();
 extern FILE *yyin;
 extern void reset_scanner();
+extern void scanner_use_buffer(char* data, size_t size);
 extern bool has_syntax_error;
+extern CSVGenerator* streaming_sink;
+extern CSVGenerator* ndjson_sink;
 
 // Flag for printing AST
 bool print_ast = false;
 
+// Flag for streaming input mode
+bool stream_input = false;
+
+// Flag for NDJSON / concatenated multi-document input mode
+bool ndjson_input = false;
+
+// Flag for emitting run statistics as JSON on stderr
+bool emit_stats = false;
+
+// Flag for incremental re-run mode
+bool delta_mode = false;
+
+// Flag for the flex-free lexer front-end
+bool fast_scan = false;
+
+// Split a comma-separated flag value into its entries
+static std::vector<std::string> split_list(const char* arg) {
+    std::vector<std::string> parts;
+    std::stringstream ss(arg);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+// Per-table spill budget in bytes (0 = disabled)
+size_t spill_budget = 0;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
 void print_usage() {
-    std::cerr << "Usage: json2relcsv [--print-ast] [--out-dir DIR]" << std::endl;
+    std::cerr << "Usage: json2relcsv [--print-ast] [--stream] [--ndjson] [--threads N] [--fast-scan] [--tables a,b] [--columns t.col,...] [--input FILE] [--schema-cache FILE] [--delta] [--spill-mb N] [--compress gzip] [--format csv|columnar] [--stats] [--out-dir DIR]" << std::endl;
 }
 
 int main(int argc, char** argv) {
     std::string out_dir = ".";
+    int thread_count = 0;  // 0 = auto-detect
+    std::string schema_cache;
+    std::string input_file;
+    std::set<std::string> table_filter;
+    std::map<std::string, std::set<std::string>> column_filter;
+    CSVCompression compression = CSVCompression::NONE;
+    OutputFormat output_format = OutputFormat::CSV;
     
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--print-ast") == 0) {
             print_ast = true;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream_input = true;
+        } else if (strcmp(argv[i], "--ndjson") == 0) {
+            ndjson_input = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            emit_stats = true;
+        } else if (strcmp(argv[i], "--delta") == 0) {
+            delta_mode = true;
+        } else if (strcmp(argv[i], "--fast-scan") == 0) {
+            fast_scan = true;
+        } else if (strcmp(argv[i], "--tables") == 0) {
+            if (i + 1 < argc) {
+                for (const auto& name : split_list(argv[++i])) {
+                    table_filter.insert(name);
+                }
+            } else {
+                std::cerr << "Error: --tables requires a comma-separated list of table names" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--columns") == 0) {
+            if (i + 1 < argc) {
+                for (const auto& entry : split_list(argv[++i])) {
+                    size_t dot = entry.find('.');
+                    if (dot == std::string::npos || dot == 0 || dot + 1 == entry.size()) {
+                        std::cerr << "Error: --columns entries must look like table.column" << std::endl;
+                        print_usage();
+                        return 1;
+                    }
+                    column_filter[entry.substr(0, dot)].insert(entry.substr(dot + 1));
+                }
+            } else {
+                std::cerr << "Error: --columns requires a comma-separated list of table.column names" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--spill-mb") == 0) {
+            if (i + 1 < argc) {
+                spill_budget = static_cast<size_t>(std::atoll(argv[++i])) * 1024 * 1024;
+            } else {
+                std::cerr << "Error: --spill-mb requires a size in megabytes" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            if (i + 1 < argc) {
+                const char* mode = argv[++i];
+                if (strcmp(mode, "gzip") == 0) {
+                    compression = CSVCompression::GZIP;
+                } else if (strcmp(mode, "zstd") == 0) {
+                    std::cerr << "Error: --compress zstd is not available in this build (compiled without libzstd); use gzip" << std::endl;
+                    return 1;
+                } else {
+                    std::cerr << "Error: --compress supports gzip (or zstd when built with libzstd)" << std::endl;
+                    print_usage();
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --compress requires a mode (gzip)" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--format") == 0) {
+            if (i + 1 < argc) {
+                const char* fmt = argv[++i];
+                if (strcmp(fmt, "csv") == 0) {
+                    output_format = OutputFormat::CSV;
+                } else if (strcmp(fmt, "columnar") == 0) {
+                    output_format = OutputFormat::COLUMNAR;
+                } else {
+                    std::cerr << "Error: --format supports csv or columnar" << std::endl;
+                    print_usage();
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --format requires a backend (csv or columnar)" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                thread_count = std::atoi(argv[++i]);
+            } else {
+                std::cerr << "Error: --threads requires a count" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--input") == 0) {
+            if (i + 1 < argc) {
+                input_file = argv[++i];
+            } else {
+                std::cerr << "Error: --input requires a file path" << std::endl;
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--schema-cache") == 0) {
+            if (i + 1 < argc) {
+                schema_cache = argv[++i];
+            } else {
+                std::cerr << "Error: --schema-cache requires a file path" << std::endl;
+                print_usage();
+                return 1;
+            }
         } else if (strcmp(argv[i], "--out-dir") == 0) {
             if (i + 1 < argc) {
                 out_dir = argv[++i];
@@ -43,12 +202,131 @@ int main(int argc, char** argv) {
         }
     }
     
-    // Set input source to stdin
-    yyin = stdin;
+    // Set input source: memory-map --input files so the scanner works on
+    // the file bytes in place, with no stdio copy; fall back to buffered
+    // reads when mapping is not possible. Default remains stdin.
+    char* mapped = nullptr;
+    size_t mapped_size = 0;
+    std::string slurped;
+    if (!input_file.empty()) {
+        int fd = open(input_file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error: Could not open input file " << input_file << std::endl;
+            return 1;
+        }
+        
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            std::cerr << "Error: Could not stat input file " << input_file << std::endl;
+            close(fd);
+            return 1;
+        }
+        
+        // The scanner needs two writable NUL sentinels after the content;
+        // a private mapping's zero-filled tail of the last partial page
+        // provides them. Exact-multiple-of-page-size files fall back to
+        // stdio reads rather than mapping an extra page.
+        size_t size = static_cast<size_t>(st.st_size);
+        long page = sysconf(_SC_PAGESIZE);
+        size_t tail = page > 0 ? size % static_cast<size_t>(page) : 0;
+        if (size > 0 && page > 0 && tail != 0 && tail < static_cast<size_t>(page) - 1) {
+            void* addr = mmap(nullptr, size + 2, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                mapped = static_cast<char*>(addr);
+                mapped_size = size;
+            }
+        }
+        
+        if (mapped) {
+            close(fd);
+            mapped[mapped_size] = '\0';
+            mapped[mapped_size + 1] = '\0';
+            if (fast_scan) {
+                fastScanBuffer(mapped, mapped_size, thread_count);
+            } else {
+                scanner_use_buffer(mapped, mapped_size);
+            }
+        } else {
+            close(fd);
+            if (fast_scan) {
+                // Fast-scan needs the whole input in memory; slurp files
+                // that could not be mapped
+                std::ifstream in(input_file, std::ios::binary);
+                slurped.assign(std::istreambuf_iterator<char>(in),
+                               std::istreambuf_iterator<char>());
+                fastScanBuffer(slurped.data(), slurped.size(), thread_count);
+            } else {
+                yyin = fopen(input_file.c_str(), "r");
+                if (!yyin) {
+                    std::cerr << "Error: Could not open input file " << input_file << std::endl;
+                    return 1;
+                }
+            }
+        }
+    } else if (fast_scan) {
+        // No seekable file to map on stdin, so buffer it whole
+        slurped.assign(std::istreambuf_iterator<char>(std::cin),
+                       std::istreambuf_iterator<char>());
+        fastScanBuffer(slurped.data(), slurped.size(), thread_count);
+    } else {
+        yyin = stdin;
+    }
     
     try {
+        // In streaming mode the generator consumes top-level array elements
+        // as the parser completes them, so it must exist before yyparse()
+        CSVGenerator generator(out_dir, stream_input || ndjson_input);
+        generator.setThreadCount(thread_count);
+        if (compression != CSVCompression::NONE) {
+            generator.setCompression(compression);
+        }
+        if (output_format == OutputFormat::COLUMNAR) {
+            if (stream_input || ndjson_input) {
+                // Columnar chunks need the whole column before any byte of
+                // it is written, which streaming exists to avoid
+                std::cerr << "Warning: --format columnar only applies to batch mode, ignoring" << std::endl;
+            } else {
+                generator.setOutputFormat(OutputFormat::COLUMNAR);
+                if (spill_budget > 0) {
+                    std::cerr << "Warning: --spill-mb applies to the CSV backend, ignoring" << std::endl;
+                }
+            }
+        }
+        if (spill_budget > 0) {
+            generator.setSpillBudget(spill_budget);
+        }
+        if (delta_mode) {
+            if (stream_input || ndjson_input) {
+                // Streaming emits rows before the whole input is known, so
+                // there is no complete record range to compare against
+                std::cerr << "Warning: --delta only applies to batch mode, ignoring" << std::endl;
+            } else {
+                generator.setDeltaMode(true);
+            }
+        }
+        if (!schema_cache.empty()) {
+            generator.setSchemaCachePath(schema_cache);
+        }
+        if (!table_filter.empty()) {
+            generator.setTableFilter(std::move(table_filter));
+        }
+        if (!column_filter.empty()) {
+            generator.setColumnFilter(std::move(column_filter));
+        }
+        if (stream_input) {
+            streaming_sink = &generator;
+        }
+        if (ndjson_input) {
+            // Large array documents also stream element-wise during the
+            // parse, so memory stays bounded by the largest single record
+            streaming_sink = &generator;
+            ndjson_sink = &generator;
+        }
+        
         // Parse the input
+        auto phase_start = std::chrono::steady_clock::now();
         int parse_result = yyparse();
+        runStats().parseMs = elapsed_ms(phase_start);
         
         // Check for parsing errors
         if (parse_result != 0 || has_syntax_error) {
@@ -56,21 +334,45 @@ int main(int argc, char** argv) {
             return 1;
         }
         
-        // Assign IDs to AST nodes
-        ast.assignIds();
-        
-        // Generate CSV files
-        try {
-            CSVGenerator generator(out_dir);
-            generator.generateCSV(ast);
-        } catch (const std::exception& e) {
-            std::cerr << "Error during CSV generation: " << e.what() << std::endl;
-            return 1;
+        if (stream_input || ndjson_input) {
+            // A non-array root has no elements to stream, so nothing ever
+            // reached the sink; fall back to the batch walk instead of
+            // silently writing no output
+            AstNode* root = ast.getRoot();
+            if (stream_input && !ndjson_input && root &&
+                root->getType() != NodeType::ARRAY) {
+                std::cerr << "Warning: --stream input has a non-array root, generating in batch mode" << std::endl;
+                try {
+                    generator.generateCSV(ast);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error during CSV generation: " << e.what() << std::endl;
+                    return 1;
+                }
+            }
+            generator.finishStreaming();
+        } else {
+            // Generate CSV files (ids are stamped during the analyze walk)
+            try {
+                generator.generateCSV(ast);
+            } catch (const std::exception& e) {
+                std::cerr << "Error during CSV generation: " << e.what() << std::endl;
+                return 1;
+            }
         }
     } catch (const std::exception& e) {
         std::cerr << "Unexpected error: " << e.what() << std::endl;
         return 1;
     }
     
+    if (mapped) {
+        munmap(mapped, mapped_size + 2);
+    }
+    
+    if (emit_stats) {
+        runStats().arenaBytes = ast.arena().bytesReserved();
+        runStats().internedKeys = keyInterner().size();
+        runStats().emitJson(std::cerr);
+    }
+    
     return 0;
 }
\ No newline at end of file
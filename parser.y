@@ -5,10 +5,18 @@
 #include <vector>
 #include <cstdlib>
 #include "ast.h"
+#include "csv_generator.h"
+#include "stats.h"
+#include "strkernels.h"
 
 // Forward declarations
 extern int yylex();
 extern int yyparse();
+// The parser pulls tokens through this dispatcher so --fast-scan can swap
+// in the pre-scanned token stream; it calls the flex yylex() otherwise
+// (see fast_scanner.h)
+extern int json2relcsv_lex();
+#define yylex json2relcsv_lex
 extern FILE *yyin;
 extern int lineno;
 extern int column;
@@ -24,20 +32,48 @@ extern bool print_ast;
 // Error recovery flag
 bool has_syntax_error = false;
 
+// Streaming input mode: when set (by main), completed top-level array
+// elements are handed to the generator and freed instead of being kept in
+// the tree, so memory stays bounded by the largest single record.
+CSVGenerator* streaming_sink = nullptr;
+
+// NDJSON / concatenated-document mode: when set (by main), each completed
+// top-level document is handed to the generator and freed, so one process
+// converts a whole newline-delimited stream in a single pass.
+CSVGenerator* ndjson_sink = nullptr;
+
+// Number of currently open containers; 1 while inside the root array only
+static int container_depth = 0;
+
 %}
 
+%code requires {
+#include <string>
+// Semantic value of STRING tokens. The flex path decodes eagerly into an
+// owned heap string; --fast-scan hands over a raw undecoded slice of the
+// input buffer instead, so string values the generator never touches are
+// never unescaped (keys are always decoded - interning needs the text).
+struct LexString {
+    std::string* text;   // owned, eagerly decoded (flex path)
+    const char* raw;     // non-owning slice into the input (--fast-scan)
+    unsigned raw_len;
+};
+}
+
 %union {
     std::string* string_val;
+    LexString lexstr_val;
     bool bool_val;
     AstNode* node_val;
     ObjectNode* object_val;
     ArrayNode* array_val;
     KeyValuePair* pair_val;
     std::vector<KeyValuePair>* pairs_val;
-    std::vector<std::shared_ptr<AstNode>>* elements_val;
+    std::vector<AstNode*>* elements_val;
 }
 
-%token <string_val> STRING NUMBER
+%token <lexstr_val> STRING
+%token <string_val> NUMBER
 %token <bool_val> TRUE FALSE
 %token NUL ERROR
 
@@ -52,47 +88,77 @@ bool has_syntax_error = false;
 
 %%
 
-json: value {
-    ast.setRoot(std::shared_ptr<AstNode>($1));
-    if (print_ast) {
-        ast.print(std::cout);
-    }
-}
+json: documents
 | error {
     has_syntax_error = true;
     std::cerr << "JSON syntax error, attempting to recover..." << std::endl;
     // Create a minimal valid AST
-    ast.setRoot(std::make_shared<ObjectNode>());
+    ast.setRoot(ast.arena().make<ObjectNode>());
     YYABORT;
 }
 ;
 
+documents: document
+| documents document
+;
+
+document: value {
+    if (ndjson_sink) {
+        ndjson_sink->consumeDocument($1);
+        ast.arena().reset();
+    } else if (ast.getRoot()) {
+        has_syntax_error = true;
+        std::cerr << "Unexpected trailing document at line " << lineno
+                  << " (use --ndjson for multi-document input)" << std::endl;
+        YYABORT;
+    } else {
+        ast.setRoot($1);
+        if (print_ast) {
+            ast.print(std::cout);
+        }
+    }
+}
+;
+
 value: object    { $$ = $1; }
     | array      { $$ = $1; }
-    | STRING     { $$ = new StringNode(*$1); delete $1; }
-    | NUMBER     { $$ = new NumberNode(*$1); delete $1; }
-    | TRUE       { $$ = new BooleanNode(true); }
-    | FALSE      { $$ = new BooleanNode(false); }
-    | NUL        { $$ = new NullNode(); }
+    | STRING     {
+        if ($1.raw) {
+            $$ = ast.arena().make<StringNode>($1.raw, $1.raw_len);
+        } else {
+            $$ = ast.arena().make<StringNode>(std::move(*$1.text));
+            delete $1.text;
+        }
+        runStats().stringNodes++;
+    }
+    | NUMBER     { $$ = ast.arena().make<NumberNode>(std::move(*$1)); delete $1; runStats().numberNodes++; }
+    | TRUE       { $$ = ast.arena().make<BooleanNode>(true); runStats().booleanNodes++; }
+    | FALSE      { $$ = ast.arena().make<BooleanNode>(false); runStats().booleanNodes++; }
+    | NUL        { $$ = ast.arena().make<NullNode>(); runStats().nullNodes++; }
     | error      { 
-        $$ = new NullNode(); 
+        $$ = ast.arena().make<NullNode>(); runStats().nullNodes++;
         has_syntax_error = true;
         std::cerr << "Syntax error in value at line " << lineno << ", column " << column << std::endl;
     }
 ;
 
-object: '{' pairs '}' {
-    $$ = new ObjectNode();
+object: lbrace pairs '}' {
+    container_depth--;
+    $$ = ast.arena().make<ObjectNode>();
+    runStats().objectNodes++;
     if ($2) {
         $$->pairs = std::move(*$2);
         delete $2;
     }
 }
-    | '{' '}' {
-    $$ = new ObjectNode();
+    | lbrace '}' {
+    container_depth--;
+    $$ = ast.arena().make<ObjectNode>();
+    runStats().objectNodes++;
 }
-    | '{' pairs error {
-    $$ = new ObjectNode();
+    | lbrace pairs error {
+    container_depth--;
+    $$ = ast.arena().make<ObjectNode>();
     if ($2) {
         $$->pairs = std::move(*$2);
         delete $2;
@@ -102,6 +168,12 @@ object: '{' pairs '}' {
 }
 ;
 
+lbrace: '{' { container_depth++; }
+;
+
+lbracket: '[' { container_depth++; }
+;
+
 pairs: pair {
     $$ = new std::vector<KeyValuePair>();
     $$->push_back(std::move(*$1));
@@ -122,29 +194,40 @@ pairs: pair {
 ;
 
 pair: STRING ':' value {
-    $$ = new KeyValuePair(*$1, std::shared_ptr<AstNode>($3));
-    delete $1;
+    const InternedString* key = $1.raw
+        ? keyInterner().intern(strkernels::unescapeJson($1.raw, $1.raw_len))
+        : keyInterner().intern(*$1.text);
+    if (!$1.raw) delete $1.text;
+    $$ = new KeyValuePair(key, $3);
 }
     | STRING error value {
-    $$ = new KeyValuePair(*$1, std::shared_ptr<AstNode>($3));
-    delete $1;
+    const InternedString* key = $1.raw
+        ? keyInterner().intern(strkernels::unescapeJson($1.raw, $1.raw_len))
+        : keyInterner().intern(*$1.text);
+    if (!$1.raw) delete $1.text;
+    $$ = new KeyValuePair(key, $3);
     has_syntax_error = true;
     std::cerr << "Missing colon in key-value pair at line " << lineno << std::endl;
 }
 ;
 
-array: '[' elements ']' {
-    $$ = new ArrayNode();
+array: lbracket elements ']' {
+    container_depth--;
+    $$ = ast.arena().make<ArrayNode>();
+    runStats().arrayNodes++;
     if ($2) {
         $$->elements = std::move(*$2);
         delete $2;
     }
 }
-    | '[' ']' {
-    $$ = new ArrayNode();
+    | lbracket ']' {
+    container_depth--;
+    $$ = ast.arena().make<ArrayNode>();
+    runStats().arrayNodes++;
 }
-    | '[' elements error {
-    $$ = new ArrayNode();
+    | lbracket elements error {
+    container_depth--;
+    $$ = ast.arena().make<ArrayNode>();
     if ($2) {
         $$->elements = std::move(*$2);
         delete $2;
@@ -155,16 +238,31 @@ array: '[' elements ']' {
 ;
 
 elements: value {
-    $$ = new std::vector<std::shared_ptr<AstNode>>();
-    $$->push_back(std::shared_ptr<AstNode>($1));
+    $$ = new std::vector<AstNode*>();
+    if (streaming_sink && container_depth == 1) {
+        streaming_sink->consumeTopLevelValue($1);
+        ast.arena().reset();
+    } else {
+        $$->push_back($1);
+    }
 }
     | elements ',' value {
     $$ = $1;
-    $$->push_back(std::shared_ptr<AstNode>($3));
+    if (streaming_sink && container_depth == 1) {
+        streaming_sink->consumeTopLevelValue($3);
+        ast.arena().reset();
+    } else {
+        $$->push_back($3);
+    }
 }
     | elements error value {
     $$ = $1;
-    $$->push_back(std::shared_ptr<AstNode>($3));
+    if (streaming_sink && container_depth == 1) {
+        streaming_sink->consumeTopLevelValue($3);
+        ast.arena().reset();
+    } else {
+        $$->push_back($3);
+    }
     has_syntax_error = true;
     std::cerr << "Missing comma in array elements at line " << lineno << std::endl;
 }
@@ -0,0 +1,37 @@
+#include "stats.h"
+#include "strkernels.h"
+
+RunStats& runStats() {
+    static RunStats stats;
+    return stats;
+}
+
+void RunStats::emitJson(std::ostream& os) const {
+    os << "{";
+    os << "\"tokens\":" << tokens << ",";
+    os << "\"nodes\":{"
+       << "\"object\":" << objectNodes << ","
+       << "\"array\":" << arrayNodes << ","
+       << "\"string\":" << stringNodes << ","
+       << "\"number\":" << numberNodes << ","
+       << "\"boolean\":" << booleanNodes << ","
+       << "\"null\":" << nullNodes << "},";
+    os << "\"phases_ms\":{"
+       << "\"parse\":" << parseMs << ","
+       << "\"analyze\":" << analyzeMs << ","
+       << "\"generate\":" << generateMs << "},";
+    os << "\"allocator\":{"
+       << "\"arena_bytes\":" << arenaBytes << ","
+       << "\"interned_keys\":" << internedKeys << "},";
+    os << "\"tables\":{";
+    bool first = true;
+    for (const auto& [name, table] : tables) {
+        if (!first) os << ",";
+        first = false;
+        // Table names derive from arbitrary object keys, so they have to
+        // be escaped to keep the output parseable
+        os << "\"" << strkernels::escapeJson(name) << "\":{\"rows\":" << table.rows
+           << ",\"bytes\":" << table.bytes << "}";
+    }
+    os << "}}" << std::endl;
+}
@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <iostream>
+#include <map>
+#include <string>
+
+// Lightweight run counters for the --stats mode.
+//
+// The hot loops (scanner, parser actions, row writers) bump plain counters
+// unconditionally — they are cheap enough to stay on in production — and
+// main emits everything as one machine-readable JSON object on stderr when
+// --stats is given, so fleet telemetry can ingest it without an external
+// profiler.
+struct TableStats {
+    unsigned long long rows = 0;
+    unsigned long long bytes = 0;
+};
+
+struct RunStats {
+    // Scanner
+    unsigned long long tokens = 0;
+
+    // AST nodes built, by type
+    unsigned long long objectNodes = 0;
+    unsigned long long arrayNodes = 0;
+    unsigned long long stringNodes = 0;
+    unsigned long long numberNodes = 0;
+    unsigned long long booleanNodes = 0;
+    unsigned long long nullNodes = 0;
+
+    // Phase wall-clock times (milliseconds)
+    double parseMs = 0.0;
+    double analyzeMs = 0.0;
+    double generateMs = 0.0;
+
+    // Allocator statistics
+    unsigned long long arenaBytes = 0;
+    unsigned long long internedKeys = 0;
+
+    // Rows and bytes emitted per output table
+    std::map<std::string, TableStats> tables;
+
+    // Emit everything as a single JSON object
+    void emitJson(std::ostream& os) const;
+};
+
+// Process-wide counters
+RunStats& runStats();
+
+#endif // STATS_H
@@ -0,0 +1,189 @@
+#include "strkernels.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace strkernels {
+
+namespace {
+
+// SWAR helper: a word with the high bit set in every byte that equals needle
+inline uint64_t matchBytes(uint64_t word, uint64_t needle) {
+    uint64_t x = word ^ needle;
+    return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+}
+
+// Broadcast one byte across all eight lanes of a word
+inline uint64_t broadcast(char c) {
+    return 0x0101010101010101ULL * static_cast<unsigned char>(c);
+}
+
+} // namespace
+
+bool hasEscape(const char* data, size_t length) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i slash = _mm_set1_epi8('\\');
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, slash)) != 0) {
+            return true;
+        }
+    }
+#else
+    const uint64_t slash = broadcast('\\');
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        if (matchBytes(word, slash) != 0) {
+            return true;
+        }
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (data[i] == '\\') return true;
+    }
+    return false;
+}
+
+bool needsCSVQuoting(const char* data, size_t length) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, comma),
+                                   _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                _mm_cmpeq_epi8(chunk, newline)));
+        if (_mm_movemask_epi8(hit) != 0) {
+            return true;
+        }
+    }
+#else
+    const uint64_t comma = broadcast(',');
+    const uint64_t quote = broadcast('"');
+    const uint64_t newline = broadcast('\n');
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        if ((matchBytes(word, comma) | matchBytes(word, quote) |
+             matchBytes(word, newline)) != 0) {
+            return true;
+        }
+    }
+#endif
+
+    for (; i < length; ++i) {
+        char c = data[i];
+        if (c == ',' || c == '"' || c == '\n') return true;
+    }
+    return false;
+}
+
+std::string unescapeJson(const char* data, size_t length) {
+    // Fast path: no backslash anywhere means no escapes to expand, so the
+    // body can be copied straight through in one go
+    if (!hasEscape(data, length)) {
+        return std::string(data, length);
+    }
+
+    const char* end = data + length;
+    std::string result;
+    for (const char* p = data; p < end; ++p) {
+        if (*p == '\\') {
+            ++p;
+            if (p >= end) break;
+
+            switch (*p) {
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case '\\': result += '\\'; break;
+                case '"': result += '"'; break;
+                case '/': result += '/'; break;
+                case 'u': {
+                    // Handle Unicode escape sequences
+                    if (p + 4 >= end) {
+                        result += '?'; // Invalid unicode sequence
+                    } else {
+                        char hex[5] = {p[1], p[2], p[3], p[4], 0};
+                        int code = strtol(hex, nullptr, 16);
+                        // Convert UTF-16 to UTF-8
+                        if (code <= 0x7F) {
+                            result += static_cast<char>(code);
+                        } else if (code <= 0x7FF) {
+                            result += static_cast<char>(0xC0 | (code >> 6));
+                            result += static_cast<char>(0x80 | (code & 0x3F));
+                        } else {
+                            result += static_cast<char>(0xE0 | (code >> 12));
+                            result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                            result += static_cast<char>(0x80 | (code & 0x3F));
+                        }
+                        p += 4; // Skip the hex digits
+                    }
+                    break;
+                }
+                default: result += *p; break;
+            }
+        } else {
+            result += *p;
+        }
+    }
+
+    return result;
+}
+
+std::string escapeJson(const std::string& value) {
+    // Fast path: scan for the first byte that needs escaping and return
+    // the input untouched when there is none
+    size_t clean = 0;
+    while (clean < value.size()) {
+        unsigned char c = static_cast<unsigned char>(value[clean]);
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        ++clean;
+    }
+    if (clean == value.size()) {
+        return value;
+    }
+
+    std::string result;
+    result.reserve(value.size() + 2);
+    result.append(value, 0, clean);
+    for (size_t i = clean; i < value.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    result += buf;
+                } else {
+                    result += value[i];
+                }
+                break;
+        }
+    }
+    return result;
+}
+
+} // namespace strkernels
@@ -0,0 +1,37 @@
+#ifndef STRKERNELS_H
+#define STRKERNELS_H
+
+#include <cstddef>
+#include <string>
+
+// Vectorized scan kernels for the string hot paths.
+//
+// Most strings contain no escapes and no characters that force CSV quoting,
+// so the unescape loop in the scanner and the quoting loop in the CSV
+// generator can take a straight-copy fast path whenever these scans come
+// back clean. The kernels examine 16 bytes per step with SSE2 (8 with the
+// portable SWAR fallback) instead of one.
+namespace strkernels {
+
+// True if data contains a backslash, i.e. the JSON unescape loop is needed
+bool hasEscape(const char* data, size_t length);
+
+// True if data contains a comma, double quote, or newline, i.e. the field
+// must go through the CSV quoting loop
+bool needsCSVQuoting(const char* data, size_t length);
+
+// Decode a JSON string body (no surrounding quotes) into its final value,
+// expanding escapes; escape-free inputs take a straight-copy fast path.
+// Both lexer paths and the lazy StringNode decode share this one routine.
+std::string unescapeJson(const char* data, size_t length);
+
+// Encode a string as a JSON string literal body (no surrounding quotes),
+// escaping quotes, backslashes, and control characters; clean inputs are
+// returned as-is. Anything interpolated into JSON output (e.g. table
+// names in --stats, which come from arbitrary object keys) goes through
+// here.
+std::string escapeJson(const std::string& value);
+
+} // namespace strkernels
+
+#endif // STRKERNELS_H